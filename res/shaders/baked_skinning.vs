@@ -0,0 +1,66 @@
+#version 330 core
+
+in vec3 a_vertex;
+in vec3 a_normal;
+in vec4 a_color;
+in vec2 a_uv;
+in ivec4 a_bones;
+in vec4 a_weights;
+
+// model of every instance (see Mesh::render_instanced)
+in mat4 u_model;
+
+uniform mat4 u_viewprojection;
+uniform vec3 u_camera_position;
+
+// baked skin matrices (see BakedPalettes): one row per frame and 3 texels per joint with the first 3 rows of its matrix
+uniform sampler2D u_palette_texture;
+uniform int u_palette_first_frame;		// row of the first frame of the clip
+uniform int u_palette_num_frames;		// frames of the clip
+uniform int u_palette_looping;			// the frames of the instances wrap if the clip loops, and are clamped otherwise
+uniform int u_palette_frame;			// frame of the first instance
+uniform int u_palette_instance_offset;	// frames between consecutive instances, so they do not move in sync
+
+//this will store the color for the pixel shader
+out vec3 v_position;
+out vec3 v_world_position;
+out vec3 v_normal;
+out vec4 v_color;
+out vec2 v_uv;
+
+mat4 fetch_skin_matrix(int row, int joint)
+{
+	vec4 r0 = texelFetch(u_palette_texture, ivec2(joint * 3, row), 0);
+	vec4 r1 = texelFetch(u_palette_texture, ivec2(joint * 3 + 1, row), 0);
+	vec4 r2 = texelFetch(u_palette_texture, ivec2(joint * 3 + 2, row), 0);
+	return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main()
+{
+	//frame of this instance
+	int frame = u_palette_frame + gl_InstanceID * u_palette_instance_offset;
+	frame = u_palette_looping != 0 ? frame % u_palette_num_frames : min(frame, u_palette_num_frames - 1);
+	int row = u_palette_first_frame + frame;
+
+	mat4 skin = fetch_skin_matrix(row, a_bones.x) * a_weights.x
+			  + fetch_skin_matrix(row, a_bones.y) * a_weights.y
+			  + fetch_skin_matrix(row, a_bones.z) * a_weights.z
+			  + fetch_skin_matrix(row, a_bones.w) * a_weights.w;
+
+	//calcule the normal in camera space (the NormalMatrix is like ViewMatrix but without traslation)
+	v_normal = (u_model * skin * vec4( a_normal, 0.0) ).xyz;
+	
+	//calcule the vertex in object space
+	v_position = (skin * vec4( a_vertex, 1.0) ).xyz;
+	v_world_position = (u_model * vec4( v_position, 1.0) ).xyz;
+	
+	//store the color in the varying var to use it from the pixel shader
+	v_color = a_color;
+
+	//store the texture coordinates
+	v_uv = a_uv;
+
+	//calcule the position of the vertex using the matrices
+	gl_Position = u_viewprojection * vec4( v_world_position, 1.0 );
+}
\ No newline at end of file
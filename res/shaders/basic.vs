@@ -5,6 +5,22 @@ in vec3 a_normal;
 in vec4 a_color;
 in vec2 a_uv;
 
+#if defined(SKINNING) || defined(DUAL_QUAT_SKINNING)
+in ivec4 a_bones;
+in vec4 a_weights;
+#endif
+
+// the palettes are texture buffers (see SkinPalettes), so they can have any number of joints
+#ifdef SKINNING
+// skin matrix of every joint (see Skeleton::get_skin_matrices): its 4 columns
+uniform samplerBuffer u_skin_matrices;
+#endif
+
+#ifdef DUAL_QUAT_SKINNING
+// dual quaternion of every joint (see Skeleton::get_dual_quat_palette): the real part, then the dual part
+uniform samplerBuffer u_skin_dual_quats;
+#endif
+
 uniform mat4 u_model;
 uniform mat4 u_viewprojection;
 uniform vec3 u_camera_position;
@@ -16,13 +32,58 @@ out vec3 v_normal;
 out vec4 v_color;
 out vec2 v_uv;
 
+#ifdef SKINNING
+mat4 get_skin_matrix(int joint)
+{
+	return mat4(texelFetch(u_skin_matrices, joint * 4), texelFetch(u_skin_matrices, joint * 4 + 1),
+				texelFetch(u_skin_matrices, joint * 4 + 2), texelFetch(u_skin_matrices, joint * 4 + 3));
+}
+#endif
+
+#ifdef DUAL_QUAT_SKINNING
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
+
 void main()
 {	
+	vec3 vertex = a_vertex;
+	vec3 normal = a_normal;
+#ifdef SKINNING
+	//blend the skin matrices of the bones
+	mat4 skin = get_skin_matrix(a_bones.x) * a_weights.x
+			  + get_skin_matrix(a_bones.y) * a_weights.y
+			  + get_skin_matrix(a_bones.z) * a_weights.z
+			  + get_skin_matrix(a_bones.w) * a_weights.w;
+	vertex = (skin * vec4( vertex, 1.0) ).xyz;
+	normal = (skin * vec4( normal, 0.0) ).xyz;
+#endif
+#ifdef DUAL_QUAT_SKINNING
+	//blend the dual quaternions of the bones in the hemisphere of the first one, and normalize the blend
+	vec4 r0 = texelFetch(u_skin_dual_quats, 2 * a_bones.x);
+	vec4 real = vec4(0.0);
+	vec4 dual = vec4(0.0);
+	for (int i = 0; i < 4; i++) {
+		vec4 r = texelFetch(u_skin_dual_quats, 2 * a_bones[i]);
+		float w = dot(r, r0) < 0.0 ? -a_weights[i] : a_weights[i];
+		real += r * w;
+		dual += texelFetch(u_skin_dual_quats, 2 * a_bones[i] + 1) * w;
+	}
+	float real_length = length(real);
+	real /= real_length;
+	dual /= real_length;
+	vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+	vertex = rotate(real, vertex) + translation;
+	normal = rotate(real, normal);
+#endif
+
 	//calcule the normal in camera space (the NormalMatrix is like ViewMatrix but without traslation)
-	v_normal = (u_model * vec4( a_normal, 0.0) ).xyz;
+	v_normal = (u_model * vec4( normal, 0.0) ).xyz;
 	
 	//calcule the vertex in object space
-	v_position = a_vertex;
+	v_position = vertex;
 	v_world_position = (u_model * vec4( v_position, 1.0) ).xyz;
 	
 	//store the color in the varying var to use it from the pixel shader
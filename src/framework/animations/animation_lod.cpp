@@ -0,0 +1,119 @@
+#include "animation_lod.h"
+#include "../frame_arena.h"
+
+#include <algorithm>
+#include <cmath>
+
+AnimationLODSettings AnimationLOD::settings;
+std::atomic<unsigned int> AnimationLOD::num_entities[NUM_ANIMATION_LODS] = {};
+
+float AnimationLOD::get_screen_size(const Camera& camera, const vec3& center, float radius)
+{
+	// the second row of the view projection matrix is the up axis of the view scaled by the projection, so its length is that scale:
+	// a sphere at depth w spans 2 * radius * scale / w in NDC, out of the 2 units of the screen height
+	const mat4& vp = camera.viewprojection_matrix;
+	vec4 clip = vp * vec4(center, 1.0f);
+	if (camera.type == Camera::PERSPECTIVE && clip.w <= radius) {
+		return 1.0f;
+	}
+	float scale = sqrtf(vp.r1c0 * vp.r1c0 + vp.r1c1 * vp.r1c1 + vp.r1c2 * vp.r1c2);
+	float w = camera.type == Camera::PERSPECTIVE ? clip.w : 1.0f;
+	return std::min(radius * scale / w, 1.0f);
+}
+
+unsigned int AnimationLOD::get_num_entities(unsigned int level)
+{
+	return num_entities[level];
+}
+
+void AnimationLOD::reset_counts()
+{
+	for (unsigned int i = 0; i < NUM_ANIMATION_LODS; i++) {
+		num_entities[i] = 0;
+	}
+}
+
+unsigned int AnimationLOD::select_level(float screen_size)
+{
+	level = 0;
+	while (level < NUM_ANIMATION_LODS - 1 && screen_size < settings.min_screen_size[level]) {
+		level++;
+	}
+	num_entities[level]++;
+	return level;
+}
+
+unsigned int AnimationLOD::get_level() const
+{
+	return level;
+}
+
+bool AnimationLOD::is_frozen() const
+{
+	return settings.update_interval[level] == 0;
+}
+
+void AnimationLOD::update_joint_masks(Pose& pose)
+{
+	const std::shared_ptr<const Rig>& rig = pose.get_rig();
+	if (rig == mask_rig) {
+		return;
+	}
+	mask_rig = rig;
+
+	// levels of descendants of every joint: the children are evaluated after their parents, so the order is walked backwards
+	const std::vector<unsigned int>& order = rig->get_evaluation_order();
+	const std::vector<int>& parents = rig->get_parents();
+	unsigned int num_joints = (unsigned int)order.size();
+	frame_vector<unsigned int> height(num_joints, 0);
+	for (unsigned int k = num_joints; k-- > 0;) {
+		unsigned int i = order[k];
+		int parent_id = parents[i];
+		if (parent_id >= 0 && parent_id < (int)num_joints) {
+			height[parent_id] = std::max(height[parent_id], height[i] + 1);
+		}
+	}
+
+	for (unsigned int l = 0; l < NUM_ANIMATION_LODS; l++) {
+		joint_masks[l].resize(num_joints);
+		for (unsigned int i = 0; i < num_joints; i++) {
+			joint_masks[l][i] = height[i] >= settings.skipped_leaf_levels[l];
+		}
+	}
+}
+
+void AnimationLOD::sample(const ClipHandle& clip, float time, float time_step, Pose& pose)
+{
+	unsigned int new_interval = settings.update_interval[level];
+	if (new_interval == 0) {
+		// frozen: the pose keeps its last value
+		frames_to_update = 0;
+		return;
+	}
+
+	update_joint_masks(pose);
+	const std::vector<unsigned char>& mask = joint_masks[level];
+	if (new_interval == 1) {
+		clip.sample(pose, time, cursor, mask);
+		frames_to_update = 0;
+		return;
+	}
+
+	// sample the clip at the time of the next update, and interpolate towards it from the pose shown now
+	if (frames_to_update == 0 || new_interval != interval) {
+		interval = new_interval;
+		frames_to_update = interval;
+		from_pose = pose;
+		to_pose = pose;
+		clip.sample(to_pose, time + time_step * (interval - 1), cursor, mask);
+	}
+
+	float t = 1.0f - (frames_to_update - 1) / (float)interval;
+	unsigned int num_joints = std::min(pose.size(), (unsigned int)mask.size());
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (mask[i]) {
+			pose.set_local_transform(i, mix(from_pose.get_local_transform(i), to_pose.get_local_transform(i), t));
+		}
+	}
+	frames_to_update--;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "clip_handle.h"
+#include "../camera.h"
+
+#define NUM_ANIMATION_LODS 4 // the last one is frozen
+
+// Levels of detail of the animation, shared by all the entities
+struct AnimationLODSettings
+{
+	// minimum screen size (fraction of the screen height covered by the bounding sphere) of the LODs 0, 1 and 2. Smaller ones are frozen
+	float min_screen_size[NUM_ANIMATION_LODS - 1] = { 0.25f, 0.08f, 0.015f };
+	// frames from a sample of the clip to the next one (the ones in between are interpolated), 0 to freeze the pose
+	unsigned int update_interval[NUM_ANIMATION_LODS] = { 1, 2, 4, 0 };
+	// skip the joints with fewer levels of descendants than this (1 skips the leaves, 2 also their parents...)
+	unsigned int skipped_leaf_levels[NUM_ANIMATION_LODS] = { 0, 1, 2, 2 };
+};
+
+// Animation LOD of an entity: the smaller the entity is on screen, the fewer frames the clip is sampled in (the pose is interpolated
+// between the samples) and the fewer joints are sampled (the leaves keep their last transform), until the pose is frozen
+class AnimationLOD
+{
+protected:
+	unsigned int level = 0;
+	unsigned int interval = 1;			// update interval of the current samples
+	unsigned int frames_to_update = 0;	// frames until the next sample
+
+	// the pose is interpolated from the pose shown at the last sample to the clip sampled at the time of the next one
+	Pose from_pose;
+	Pose to_pose;
+	ClipCursor cursor;
+
+	// joints sampled by every level (1) given the hierarchy of the pose
+	std::shared_ptr<const Rig> mask_rig;
+	std::vector<unsigned char> joint_masks[NUM_ANIMATION_LODS];
+
+	static std::atomic<unsigned int> num_entities[NUM_ANIMATION_LODS];
+
+	void update_joint_masks(Pose& pose);
+
+public:
+	static AnimationLODSettings settings;
+
+	// Fraction of the screen height covered by a sphere in world space (1 if the camera is inside it)
+	static float get_screen_size(const Camera& camera, const vec3& center, float radius);
+	// Number of entities at each level this frame (reset every frame by the application)
+	static unsigned int get_num_entities(unsigned int level);
+	static void reset_counts();
+
+	// Choose the level for the screen size of the entity this frame
+	unsigned int select_level(float screen_size);
+	unsigned int get_level() const;
+	bool is_frozen() const;
+
+	// Update the pose playing the clip at the given time at the selected level. time_step is the time the clip advances per frame,
+	// to sample ahead the pose of the next update. Only a Clip skips the joints of the level (see ClipHandle::sample)
+	void sample(const ClipHandle& clip, float time, float time_step, Pose& pose);
+};
\ No newline at end of file
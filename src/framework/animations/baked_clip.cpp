@@ -0,0 +1,135 @@
+#include "baked_clip.h"
+#include "pose_soa.h"
+
+#include <algorithm>
+#include <cmath>
+
+BakedClip::BakedClip() { }
+
+BakedClip::BakedClip(const Clip& clip, Pose& rest_pose, float frame_rate)
+{
+	name = clip.get_name();
+	start_time = clip.get_start_time();
+	end_time = clip.get_end_time();
+	looping = clip.get_looping();
+
+	// the animated joints of the pose
+	unsigned int num_joints = rest_pose.size();
+	std::vector<unsigned int> tracks;
+	for (unsigned int i = 0; i < clip.size(); i++) {
+		if (clip.get_track(i).joint_id < num_joints) {
+			tracks.push_back(i);
+			joint_ids.push_back(clip.get_track(i).joint_id);
+		}
+	}
+	unsigned int num_slots = (unsigned int)joint_ids.size();
+	stride = (num_slots + 7) / 8 * 8;
+
+	// frames evenly spaced from the start to the end of the clip, so the last one is exactly the end
+	float duration = get_duration();
+	num_frames = std::max(2u, (unsigned int)ceilf(duration * frame_rate) + 1);
+	frame_duration = duration / (num_frames - 1);
+
+	// the padding slots hold identity transforms, so mixing them is harmless
+	data.assign((size_t)num_frames * 10 * stride, 0.0f);
+	std::vector<unsigned int> cursors(tracks.size() * 3, 0);
+	for (unsigned int f = 0; f < num_frames; f++) {
+		float time = f == num_frames - 1 ? end_time : start_time + f * frame_duration;
+		float* frame = &data[(size_t)f * 10 * stride];
+		for (unsigned int slot = 0; slot < stride; slot++) {
+			Transform t;
+			if (slot < num_slots) {
+				t = clip.get_track(tracks[slot]).sample(rest_pose.get_local_transform(joint_ids[slot]), time, &cursors[slot * 3]);
+			}
+			float components[10] = { t.position.x, t.position.y, t.position.z, t.rotation.x, t.rotation.y, t.rotation.z, t.rotation.w, t.scale.x, t.scale.y, t.scale.z };
+			for (unsigned int c = 0; c < 10; c++) {
+				frame[c * stride + slot] = components[c];
+			}
+		}
+	}
+}
+
+const float* BakedClip::get_frame(unsigned int frame) const
+{
+	return &data[(size_t)frame * 10 * stride];
+}
+
+const std::string& BakedClip::get_name() const
+{
+	return name;
+}
+
+unsigned int BakedClip::size() const
+{
+	return (unsigned int)joint_ids.size();
+}
+
+unsigned int BakedClip::get_num_frames() const
+{
+	return num_frames;
+}
+
+size_t BakedClip::get_bytes() const
+{
+	return data.size() * sizeof(float);
+}
+
+float BakedClip::get_start_time() const
+{
+	return start_time;
+}
+
+float BakedClip::get_end_time() const
+{
+	return end_time;
+}
+
+float BakedClip::get_duration() const
+{
+	return end_time - start_time;
+}
+
+bool BakedClip::get_looping() const
+{
+	return looping;
+}
+
+void BakedClip::set_looping(bool looping)
+{
+	this->looping = looping;
+}
+
+float BakedClip::adjust_time(float time) const
+{
+	return ::adjust_time(time, start_time, end_time, looping);
+}
+
+static SIMD_INLINE simd_transform load_frame_block(const float* frame, unsigned int stride, unsigned int k)
+{
+	simd_transform block;
+	block.px = simd_load(frame + 0 * stride + k); block.py = simd_load(frame + 1 * stride + k); block.pz = simd_load(frame + 2 * stride + k);
+	block.rx = simd_load(frame + 3 * stride + k); block.ry = simd_load(frame + 4 * stride + k); block.rz = simd_load(frame + 5 * stride + k); block.rw = simd_load(frame + 6 * stride + k);
+	block.sx = simd_load(frame + 7 * stride + k); block.sy = simd_load(frame + 8 * stride + k); block.sz = simd_load(frame + 9 * stride + k);
+	return block;
+}
+
+float BakedClip::sample(Pose& pose, float time) const
+{
+	time = adjust_time(time);
+	if (num_frames == 0) {
+		return time;
+	}
+
+	float position = frame_duration > 0.0f ? (time - start_time) / frame_duration : 0.0f;
+	unsigned int frame = std::min((unsigned int)position, num_frames - 2);
+	simd_float t = simd_set1(std::clamp(position - frame, 0.0f, 1.0f));
+	const float* a = get_frame(frame);
+	const float* b = get_frame(frame + 1);
+
+	unsigned int num_slots = (unsigned int)joint_ids.size();
+	for (unsigned int k = 0; k < num_slots; k += SIMD_WIDTH) {
+		simd_transform block = simd_mix(load_frame_block(a, stride, k), load_frame_block(b, stride, k), t);
+		store_to_pose(block, k, std::min((unsigned int)SIMD_WIDTH, num_slots - k), joint_ids.data(), pose);
+	}
+	return time;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "clip.h"
+#include "../math/simd_transform.h"
+
+// Clip resampled at a fixed frame rate when it is loaded. The transforms of all the animated joints of a frame are stored together
+// (one stream per component, padded to a multiple of 8 joints), so sampling is an index and one SIMD mix of two consecutive frames,
+// without searching keys. Uses more memory than the clip, but the cost of a sample is the same at any time
+class BakedClip
+{
+protected:
+	std::string name;
+	std::vector<unsigned int> joint_ids;	// joint of each slot of a frame
+	unsigned int stride = 0;				// padded number of slots
+	unsigned int num_frames = 0;
+	float start_time = 0.0f;
+	float end_time = 0.0f;
+	float frame_duration = 0.0f;
+	bool looping = true;
+
+	// frame f: 10 streams (px, py, pz, rx, ry, rz, rw, sx, sy, sz) of stride floats starting at data[f * 10 * stride]
+	aligned_vector<float> data;
+
+	const float* get_frame(unsigned int frame) const;
+
+public:
+	BakedClip(); // Empty clip
+	// Resample the clip at the frame rate (at least). The properties the clip does not animate are taken from the rest pose
+	BakedClip(const Clip& clip, Pose& rest_pose, float frame_rate = 30.0f);
+
+	const std::string& get_name() const;
+	// Number of animated joints
+	unsigned int size() const;
+	unsigned int get_num_frames() const;
+	// Memory used by the frames
+	size_t get_bytes() const;
+
+	float get_start_time() const;
+	float get_end_time() const;
+	float get_duration() const;
+	bool get_looping() const;
+	void set_looping(bool looping);
+
+	float adjust_time(float time) const;
+	// Set the local transform of the animated joints of the pose at the given playback time. Returns the time of the clip
+	float sample(Pose& pose, float time) const;
+};
\ No newline at end of file
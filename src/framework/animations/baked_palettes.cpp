@@ -0,0 +1,183 @@
+#include "baked_palettes.h"
+#include "clip.h"
+
+#include <algorithm>
+#include <cmath>
+
+BakedPalettes::BakedPalettes() { }
+
+unsigned int BakedPalettes::add_clip_info(const std::string& name, float start_time, float end_time, bool looping, float frame_rate)
+{
+	BakedPaletteClip clip;
+	clip.name = name;
+	clip.first_frame = get_num_frames();
+	clip.start_time = start_time;
+	clip.duration = std::max(end_time - start_time, 0.0f);
+	clip.looping = looping;
+	// frames evenly spaced over the clip: a looping clip wraps from its last frame to the first one, the others end at their end
+	float frames = clip.duration * frame_rate;
+	clip.num_frames = looping ? std::max(1u, (unsigned int)ceilf(frames)) : (unsigned int)ceilf(frames) + 1;
+	clips.push_back(clip);
+	return (unsigned int)clips.size() - 1;
+}
+
+void BakedPalettes::add_frame(Skeleton& skeleton, Pose& pose)
+{
+	const std::vector<mat4>& skin_matrices = skeleton.get_skin_matrices(pose);
+	if (num_joints == 0) {
+		num_joints = (unsigned int)skin_matrices.size();
+	}
+
+	size_t offset = data.size();
+	data.resize(offset + (size_t)num_joints * 12, 0.0f);
+	float* row = &data[offset];
+	unsigned int size = std::min(num_joints, (unsigned int)skin_matrices.size());
+	for (unsigned int j = 0; j < size; j++) {
+		const mat4& m = skin_matrices[j];
+		for (unsigned int r = 0; r < 3; r++) {
+			float* texel = row + j * 12 + r * 4;
+			texel[0] = m.data[r];
+			texel[1] = m.data[4 + r];
+			texel[2] = m.data[8 + r];
+			texel[3] = m.data[12 + r];
+		}
+	}
+}
+
+unsigned int BakedPalettes::get_num_joints() const
+{
+	return num_joints;
+}
+
+unsigned int BakedPalettes::get_num_clips() const
+{
+	return (unsigned int)clips.size();
+}
+
+const BakedPaletteClip& BakedPalettes::get_clip(unsigned int clip_id) const
+{
+	return clips[clip_id];
+}
+
+unsigned int BakedPalettes::get_num_frames() const
+{
+	return clips.empty() ? 0 : clips.back().first_frame + clips.back().num_frames;
+}
+
+unsigned int BakedPalettes::get_width() const
+{
+	return num_joints * 3;
+}
+
+const float* BakedPalettes::get_data() const
+{
+	return data.data();
+}
+
+size_t BakedPalettes::get_bytes() const
+{
+	return data.size() * sizeof(float);
+}
+
+float BakedPalettes::get_frame_time(unsigned int clip_id, unsigned int frame) const
+{
+	const BakedPaletteClip& clip = clips[clip_id];
+	unsigned int intervals = clip.looping ? clip.num_frames : clip.num_frames - 1;
+	return intervals ? clip.start_time + clip.duration * frame / intervals : clip.start_time;
+}
+
+unsigned int BakedPalettes::get_frame(unsigned int clip_id, float time) const
+{
+	const BakedPaletteClip& clip = clips[clip_id];
+	if (clip.duration <= 0.0f || clip.num_frames < 2) {
+		return 0;
+	}
+
+	float t = (time - clip.start_time) / clip.duration;
+	if (clip.looping) {
+		t -= floorf(t);
+		return (unsigned int)lroundf(t * clip.num_frames) % clip.num_frames;
+	}
+	return (unsigned int)lroundf(std::clamp(t, 0.0f, 1.0f) * (clip.num_frames - 1));
+}
+
+mat4 BakedPalettes::get_skin_matrix(unsigned int row, unsigned int joint_id) const
+{
+	const float* texels = &data[((size_t)row * num_joints + joint_id) * 12];
+	mat4 m;
+	for (unsigned int r = 0; r < 3; r++) {
+		m.data[r] = texels[r * 4];
+		m.data[4 + r] = texels[r * 4 + 1];
+		m.data[8 + r] = texels[r * 4 + 2];
+		m.data[12 + r] = texels[r * 4 + 3];
+	}
+	return m;
+}
+static float max_difference(const mat4& a, const mat4& b)
+{
+	float difference = 0.0f;
+	for (unsigned int i = 0; i < 16; i++) {
+		difference = std::max(difference, fabsf(a.data[i] - b.data[i]));
+	}
+	return difference;
+}
+
+void BakedPalettes::check(unsigned int num_joints, float frame_rate, float& frame_error, float& playback_error)
+{
+	num_joints = std::max(num_joints, 1u);
+
+	// chain of bones of length 1 along y, swinging with a different phase each
+	Pose bind(num_joints);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (i > 0) {
+			bind.set_parent(i, i - 1);
+		}
+		bind.set_local_transform(i, Transform(vec3(0.0f, i > 0 ? 1.0f : 0.0f, 0.0f), quat(), vec3(1.0f, 1.0f, 1.0f)));
+	}
+	Skeleton skeleton(bind, bind, std::vector<std::string>(num_joints));
+
+	Clip clip;
+	std::vector<float> times;
+	for (unsigned int k = 0; k <= 8; k++) {
+		times.push_back(k * 0.25f);
+	}
+	for (unsigned int i = 0; i < num_joints; i++) {
+		std::vector<quat> rotations;
+		for (unsigned int k = 0; k < times.size(); k++) {
+			rotations.push_back(angle_axis(0.3f * sinf(times[k] * 3.14159265f + i * 0.5f), vec3(0.0f, 0.0f, 1.0f)));
+		}
+		clip.get_joint_track(i).rotation.set_keys(times, rotations);
+	}
+	clip.recalculate_duration();
+	Clip non_looping = clip;
+	non_looping.set_looping(false);
+
+	BakedPalettes palettes;
+	const Clip* clips[2] = { &clip, &non_looping };
+	for (unsigned int c = 0; c < 2; c++) {
+		palettes.add_clip(*clips[c], skeleton, frame_rate);
+	}
+
+	frame_error = 0.0f;
+	playback_error = 0.0f;
+	Pose pose = skeleton.get_rest_pose();
+	for (unsigned int c = 0; c < 2; c++) {
+		const BakedPaletteClip& info = palettes.get_clip(c);
+		for (unsigned int f = 0; f < info.num_frames; f++) {
+			clips[c]->sample(pose, palettes.get_frame_time(c, f));
+			const std::vector<mat4>& skin_matrices = skeleton.get_skin_matrices(pose);
+			for (unsigned int j = 0; j < num_joints; j++) {
+				frame_error = std::max(frame_error, max_difference(palettes.get_skin_matrix(info.first_frame + f, j), skin_matrices[j]));
+			}
+		}
+		// past the end too, where the looping clip wraps and the other one holds its last frame
+		for (float time = info.start_time; time < info.start_time + info.duration * 1.5f; time += 0.0123f) {
+			unsigned int row = info.first_frame + palettes.get_frame(c, time);
+			clips[c]->sample(pose, time);
+			const std::vector<mat4>& skin_matrices = skeleton.get_skin_matrices(pose);
+			for (unsigned int j = 0; j < num_joints; j++) {
+				playback_error = std::max(playback_error, max_difference(palettes.get_skin_matrix(row, j), skin_matrices[j]));
+			}
+		}
+	}
+}
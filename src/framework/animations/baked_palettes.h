@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "skeleton.h"
+
+// Clip of a BakedPalettes: its frames are the rows first_frame to first_frame + num_frames - 1
+struct BakedPaletteClip
+{
+	std::string name;
+	unsigned int first_frame = 0;
+	unsigned int num_frames = 0;
+	float start_time = 0.0f;
+	float duration = 0.0f;
+	bool looping = true;
+};
+
+// Skin matrices (global matrix * inverse bind pose matrix) of a skeleton playing some clips, evaluated on the CPU at a fixed frame
+// rate when they are loaded, so a crowd can be skinned on the GPU without any pose work per frame (see BakedSkinningMaterial)
+// The data is laid out as a RGBA float texture: one row per frame and 3 texels per joint, the first 3 rows of its skin matrix
+// (the last one is always 0, 0, 0, 1)
+class BakedPalettes
+{
+protected:
+	unsigned int num_joints = 0;
+	std::vector<BakedPaletteClip> clips;
+	std::vector<float> data; // 12 floats per joint and frame
+
+	unsigned int add_clip_info(const std::string& name, float start_time, float end_time, bool looping, float frame_rate);
+	// Append the skin matrices of the pose as a new frame
+	void add_frame(Skeleton& skeleton, Pose& pose);
+
+public:
+	BakedPalettes(); // Empty palettes
+
+	// Bake the clip played by the skeleton at the frame rate (at least) and return its id. Works with any clip type with get_name,
+	// get_start_time, get_end_time, get_looping and sample(Pose&, time) (Clip, CompressedClip or BakedClip)
+	// Looping clips do not store their end, as it is the same pose as their start
+	template <typename ClipType>
+	unsigned int add_clip(const ClipType& clip, Skeleton& skeleton, float frame_rate = 30.0f)
+	{
+		unsigned int id = add_clip_info(clip.get_name(), clip.get_start_time(), clip.get_end_time(), clip.get_looping(), frame_rate);
+		const BakedPaletteClip& info = clips[id];
+		Pose pose = skeleton.get_rest_pose();
+		for (unsigned int f = 0; f < info.num_frames; f++) {
+			clip.sample(pose, get_frame_time(id, f));
+			add_frame(skeleton, pose);
+		}
+		return id;
+	}
+
+	unsigned int get_num_joints() const;
+	unsigned int get_num_clips() const;
+	const BakedPaletteClip& get_clip(unsigned int clip_id) const;
+	// Number of frames of all the clips (the height of the texture)
+	unsigned int get_num_frames() const;
+	// Width of the texture in texels
+	unsigned int get_width() const;
+	const float* get_data() const;
+	size_t get_bytes() const;
+
+	// Time of the clip of a frame of the clip (from 0 to num_frames - 1)
+	float get_frame_time(unsigned int clip_id, unsigned int frame) const;
+	// Nearest frame of the clip (from 0 to num_frames - 1) to a playback time: wrapped if the clip loops, clamped otherwise
+	unsigned int get_frame(unsigned int clip_id, float time) const;
+	// Read back the skin matrix of a joint in a row of the texture
+	mat4 get_skin_matrix(unsigned int row, unsigned int joint_id) const;
+
+	// Bake a looping and a non looping clip of a chain of joints and compare the palettes with the skin matrices of the poses
+	// sampled directly (largest difference of an element): at the time of each frame, where they only differ by rounding, and at
+	// any playback time, which adds the error of playing the nearest frame. It does not need a GL context
+	static void check(unsigned int num_joints, float frame_rate, float& frame_error, float& playback_error);
+};
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "clip.h"
+
+#include <algorithm>
+#include <cmath>
+
+float TransformTrack::get_start_time() const
+{
+	float start_time = INFINITY;
+	if (position.size() > 0) start_time = std::min(start_time, position.get_start_time());
+	if (rotation.size() > 0) start_time = std::min(start_time, rotation.get_start_time());
+	if (scale.size() > 0) start_time = std::min(start_time, scale.get_start_time());
+	return start_time == INFINITY ? 0.0f : start_time;
+}
+
+float TransformTrack::get_end_time() const
+{
+	float end_time = -INFINITY;
+	if (position.size() > 0) end_time = std::max(end_time, position.get_end_time());
+	if (rotation.size() > 0) end_time = std::max(end_time, rotation.get_end_time());
+	if (scale.size() > 0) end_time = std::max(end_time, scale.get_end_time());
+	return end_time == -INFINITY ? 0.0f : end_time;
+}
+
+Transform TransformTrack::sample(const Transform& reference, float time, unsigned int* cursors) const
+{
+	Transform result = reference;
+	if (position.size() > 0) result.position = position.sample(time, cursors[0]);
+	if (rotation.size() > 0) result.rotation = rotation.sample(time, cursors[1]);
+	if (scale.size() > 0) result.scale = scale.sample(time, cursors[2]);
+	return result;
+}
+
+Clip::Clip() { }
+
+const std::string& Clip::get_name() const
+{
+	return name;
+}
+
+void Clip::set_name(const std::string& name)
+{
+	this->name = name;
+}
+
+unsigned int Clip::size() const
+{
+	return (unsigned int)tracks.size();
+}
+
+const TransformTrack& Clip::get_track(unsigned int index) const
+{
+	return tracks[index];
+}
+
+TransformTrack& Clip::get_track(unsigned int index)
+{
+	return tracks[index];
+}
+
+TransformTrack& Clip::get_joint_track(unsigned int joint_id)
+{
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		if (tracks[i].joint_id == joint_id) {
+			return tracks[i];
+		}
+	}
+	tracks.push_back(TransformTrack());
+	tracks.back().joint_id = joint_id;
+	return tracks.back();
+}
+
+void Clip::recalculate_duration()
+{
+	start_time = INFINITY;
+	end_time = -INFINITY;
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		start_time = std::min(start_time, tracks[i].get_start_time());
+		end_time = std::max(end_time, tracks[i].get_end_time());
+	}
+	if (tracks.empty()) {
+		start_time = end_time = 0.0f;
+	}
+}
+
+float Clip::get_start_time() const
+{
+	return start_time;
+}
+
+float Clip::get_end_time() const
+{
+	return end_time;
+}
+
+float Clip::get_duration() const
+{
+	return end_time - start_time;
+}
+
+bool Clip::get_looping() const
+{
+	return looping;
+}
+
+void Clip::set_looping(bool looping)
+{
+	this->looping = looping;
+}
+
+float Clip::adjust_time(float time) const
+{
+	return ::adjust_time(time, start_time, end_time, looping);
+}
+
+float Clip::sample(Pose& pose, float time, ClipCursor& cursor) const
+{
+	time = adjust_time(time);
+	cursor.keys.resize(tracks.size() * 3, 0);
+
+	unsigned int num_joints = pose.size();
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		unsigned int joint_id = tracks[i].joint_id;
+		if (joint_id < num_joints) {
+			pose.set_local_transform(joint_id, tracks[i].sample(pose.get_local_transform(joint_id), time, &cursor.keys[i * 3]));
+		}
+	}
+	return time;
+}
+
+float Clip::sample(Pose& pose, float time, ClipCursor& cursor, const std::vector<unsigned char>& joint_mask) const
+{
+	time = adjust_time(time);
+	cursor.keys.resize(tracks.size() * 3, 0);
+
+	unsigned int num_joints = std::min(pose.size(), (unsigned int)joint_mask.size());
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		unsigned int joint_id = tracks[i].joint_id;
+		if (joint_id < num_joints && joint_mask[joint_id]) {
+			pose.set_local_transform(joint_id, tracks[i].sample(pose.get_local_transform(joint_id), time, &cursor.keys[i * 3]));
+		}
+	}
+	return time;
+}
+
+float Clip::sample(Pose& pose, float time) const
+{
+	time = adjust_time(time);
+
+	unsigned int num_joints = pose.size();
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		unsigned int joint_id = tracks[i].joint_id;
+		if (joint_id < num_joints) {
+			unsigned int cursors[3] = { 0, 0, 0 };
+			pose.set_local_transform(joint_id, tracks[i].sample(pose.get_local_transform(joint_id), time, cursors));
+		}
+	}
+	return time;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pose.h"
+#include "track.h"
+
+// Animated position, rotation and scale of a joint. A property without keys keeps the value of the pose
+struct TransformTrack
+{
+	unsigned int joint_id = 0;
+	Track<vec3> position;
+	Track<quat> rotation;
+	Track<vec3> scale;
+
+	float get_start_time() const;
+	float get_end_time() const;
+	// Get the transform at the given time, taking the properties without keys from the reference transform
+	// cursors are the key cursors of the 3 tracks
+	Transform sample(const Transform& reference, float time, unsigned int* cursors) const;
+};
+
+// Times between two decoded keys of a compressed track. The value at a time of the segment is interpolate(from, to, t) with
+// t = (time - start) * inv_duration, which is 0 when it does not change (constant keys or out of the keys)
+struct DecodedSegment
+{
+	float start = FLT_MAX; // nothing decoded yet
+	float end = -FLT_MAX;
+	float inv_duration = 0.0f;
+};
+
+// Key cursors of every track of a clip. Each player keeps its own, so the clip can be shared (also between threads)
+// and sequential playback does not search the keys
+struct ClipCursor
+{
+	std::vector<unsigned int> keys; // 3 per track
+
+	// compressed clips decode the keys of the current segment of each track once (see CompressedClip::sample). The clip is
+	// identified by its id and not its address, as a new clip can be loaded where a freed one was
+	uint64_t decoded_clip_id = 0;
+	std::vector<DecodedSegment> decoded_segments;	// 3 per track
+	std::vector<Transform> decoded_from;			// 1 per track
+	std::vector<Transform> decoded_to;
+};
+
+// Animation of some joints of a skeleton, made of one transform track per animated joint
+class Clip
+{
+protected:
+	std::string name;
+	std::vector<TransformTrack> tracks;
+	float start_time = 0.0f;
+	float end_time = 0.0f;
+	bool looping = true;
+
+public:
+	Clip(); // Empty clip
+
+	const std::string& get_name() const;
+	void set_name(const std::string& name);
+
+	// Number of transform tracks
+	unsigned int size() const;
+	const TransformTrack& get_track(unsigned int index) const;
+	TransformTrack& get_track(unsigned int index);
+	// Get the track of the joint, adding it if the joint is not animated yet (call recalculate_duration after setting its keys)
+	TransformTrack& get_joint_track(unsigned int joint_id);
+	// Update the start and end times with the keys of the tracks
+	void recalculate_duration();
+
+	float get_start_time() const;
+	float get_end_time() const;
+	float get_duration() const;
+	bool get_looping() const;
+	void set_looping(bool looping);
+
+	// Get the time of the clip for a playback time: wrapped if the clip loops, clamped otherwise
+	float adjust_time(float time) const;
+	// Set the local transform of the animated joints of the pose at the given playback time. Returns the time of the clip
+	float sample(Pose& pose, float time, ClipCursor& cursor) const;
+	// Same, only for the joints with a non zero value in the mask (the others keep their transform)
+	float sample(Pose& pose, float time, ClipCursor& cursor, const std::vector<unsigned char>& joint_mask) const;
+	// Same, seeking the keys with a binary search
+	float sample(Pose& pose, float time) const;
+};
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "clip_cache.h"
+#include "../math/batch.h"
+#include "../job_system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+bool ClipCache::Key::operator==(const Key& other) const
+{
+	return clip == other.clip && skeleton == other.skeleton && rest_version == other.rest_version && frame == other.frame;
+}
+
+size_t ClipCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = std::hash<const void*>()(key.clip);
+	hash ^= std::hash<const void*>()(key.skeleton) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<uint64_t>()(key.rest_version) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<int64_t>()(key.frame) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+ClipCache& ClipCache::get()
+{
+	static ClipCache cache;
+	return cache;
+}
+
+ClipCache::ClipCache(unsigned int capacity, float time_step)
+{
+	this->capacity = capacity;
+	this->time_step = time_step;
+}
+
+int64_t ClipCache::quantize(float time, float start_time, float end_time, bool looping, float& sample_time) const
+{
+	// without quantization only the exact same times share a pose
+	if (time_step <= 0.0f) {
+		sample_time = time;
+		uint32_t bits;
+		memcpy(&bits, &time, sizeof(bits));
+		return bits;
+	}
+
+	int64_t frame = llroundf((time - start_time) / time_step);
+	sample_time = std::min(start_time + frame * time_step, end_time);
+	// the end of a looping clip is its start
+	if (looping && frame > 0 && sample_time >= end_time) {
+		frame = 0;
+		sample_time = start_time;
+	}
+	return frame;
+}
+
+bool ClipCache::find(const Key& key, Entry*& entry)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = lookup.find(key);
+	if (it != lookup.end()) {
+		// move it to the front of the list (the iterators stay valid)
+		entries.splice(entries.begin(), entries, it->second);
+		entry = &entries.front();
+		entry->last_used = current_frame;
+		frame_hits++;
+		return true;
+	}
+
+	// reuse the least recently used entry if the cache is full and it was not used this frame
+	if (lookup.size() >= capacity && !entries.empty() && entries.back().last_used != current_frame) {
+		Entry& last = entries.back();
+		lookup.erase({ last.clip, last.skeleton, last.rest_version, last.frame });
+		entries.splice(entries.begin(), entries, std::prev(entries.end()));
+	}
+	else {
+		entries.emplace_front();
+	}
+
+	entry = &entries.front();
+	entry->clip = key.clip;
+	entry->skeleton = key.skeleton;
+	entry->rest_version = key.rest_version;
+	entry->frame = key.frame;
+	entry->last_used = current_frame;
+	entry->ready = false;
+	lookup[key] = entries.begin();
+	frame_misses++;
+	return false;
+}
+
+void ClipCache::evict()
+{
+	while (lookup.size() > capacity && !entries.empty() && entries.back().last_used != current_frame) {
+		Entry& last = entries.back();
+		lookup.erase({ last.clip, last.skeleton, last.rest_version, last.frame });
+		entries.pop_back();
+	}
+}
+
+void ClipCache::reset_pose(Entry& entry, Skeleton& skeleton)
+{
+	// evaluate the rest pose first, so other threads do not update its cache while it is copied (copying reuses the memory of the entry)
+	Pose& rest_pose = skeleton.get_rest_pose();
+	rest_pose.get_global_matrices();
+	entry.pose = rest_pose;
+}
+
+void ClipCache::update_skin_matrices(Entry& entry, Skeleton& skeleton)
+{
+	const std::vector<mat4>& inv_bind_pose = skeleton.get_inv_bind_pose();
+	const std::vector<mat4>& global_matrices = entry.pose.get_global_matrices();
+	unsigned int size = std::min((unsigned int)global_matrices.size(), (unsigned int)inv_bind_pose.size());
+	entry.skin_matrices.resize(size);
+	multiply(global_matrices.data(), inv_bind_pose.data(), entry.skin_matrices.data(), size);
+}
+
+void ClipCache::wait_until_ready(Entry& entry)
+{
+	while (!entry.ready.load(std::memory_order_acquire)) {
+		if (!JobSystem::get().run_one()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ClipCache::new_frame()
+{
+	last_hits = frame_hits;
+	last_misses = frame_misses;
+	frame_hits = 0;
+	frame_misses = 0;
+	current_frame++;
+	// the entries added over the capacity in the last frame can go now
+	evict();
+}
+
+void ClipCache::clear()
+{
+	entries.clear();
+	lookup.clear();
+}
+
+unsigned int ClipCache::size() const
+{
+	return (unsigned int)lookup.size();
+}
+
+unsigned int ClipCache::get_capacity() const
+{
+	return capacity;
+}
+
+void ClipCache::set_capacity(unsigned int capacity)
+{
+	this->capacity = capacity;
+	evict();
+}
+
+float ClipCache::get_time_step() const
+{
+	return time_step;
+}
+
+void ClipCache::set_time_step(float time_step)
+{
+	if (time_step != this->time_step) {
+		this->time_step = time_step;
+		clear();
+	}
+}
+
+unsigned int ClipCache::get_hits() const
+{
+	return last_hits;
+}
+
+unsigned int ClipCache::get_misses() const
+{
+	return last_misses;
+}
+
+float ClipCache::get_hit_rate() const
+{
+	unsigned int lookups = last_hits + last_misses;
+	return lookups ? last_hits / (float)lookups : 0.0f;
+}
\ No newline at end of file
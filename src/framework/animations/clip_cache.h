@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "skeleton.h"
+
+// Poses (and their skin matrices) of clips sampled at quantized times, shared by every entity that plays the same clip of the same
+// skeleton at the same quantized time: a crowd playing one clip evaluates each pose once. The least recently used poses are
+// dropped when there are more than the capacity, but never the ones used in the current frame, so they stay valid until the next one
+// Entities updated in parallel can sample at once: each pose is sampled by the first one, and the rest run other jobs until it is ready
+class ClipCache
+{
+public:
+	struct Entry
+	{
+		const void* clip = nullptr;
+		const Skeleton* skeleton = nullptr;
+		uint64_t rest_version = 0;	// version of the rest pose of the skeleton (the joints the clip does not animate keep it)
+		int64_t frame = 0;			// quantized time
+		uint64_t last_used = 0;		// frame of the cache it was last used in
+		std::atomic<bool> ready = false;	// the pose and the skin matrices are sampled
+
+		Pose pose;
+		std::vector<mat4> skin_matrices;
+	};
+
+protected:
+	struct Key
+	{
+		const void* clip;
+		const Skeleton* skeleton;
+		uint64_t rest_version;
+		int64_t frame;
+
+		bool operator==(const Key& other) const;
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	std::mutex mutex;
+	std::list<Entry> entries; // most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+	unsigned int capacity = 0;
+	float time_step = 0.0f;
+
+	uint64_t current_frame = 1;
+	unsigned int frame_hits = 0;
+	unsigned int frame_misses = 0;
+	unsigned int last_hits = 0;
+	unsigned int last_misses = 0;
+
+	// Quantize a clip time (already adjusted by the clip) and get the time to sample for it
+	int64_t quantize(float time, float start_time, float end_time, bool looping, float& sample_time) const;
+	// Get the entry of the key, creating it (not ready) if it is not cached. Returns true if it was cached
+	bool find(const Key& key, Entry*& entry);
+	void evict();
+	// Start the pose of a new entry from the rest pose of the skeleton (the joints the clip does not animate keep it)
+	void reset_pose(Entry& entry, Skeleton& skeleton);
+	void update_skin_matrices(Entry& entry, Skeleton& skeleton);
+	// Wait until another job has sampled the entry, running queued jobs meanwhile (the one sampling it may be queued behind this one)
+	void wait_until_ready(Entry& entry);
+
+public:
+	// Cache of the application (see SkinnedEntity), its stats are reset every frame by the application
+	static ClipCache& get();
+
+	// Keep up to capacity poses, sampled every time_step seconds of the clips (0 to not quantize the time)
+	ClipCache(unsigned int capacity = 256, float time_step = 1.0f / 60.0f);
+
+	// Get the pose of the skeleton playing the clip at the given playback time, and its skin matrices
+	// Works with any clip type with adjust_time, get_start_time, get_end_time, get_looping and sample(Pose&, time)
+	// (Clip, CompressedClip or BakedClip). The entry is valid until the next frame of the cache
+	template <typename ClipType>
+	Entry& sample(const ClipType& clip, Skeleton& skeleton, float time)
+	{
+		float sample_time;
+		int64_t frame = quantize(clip.adjust_time(time), clip.get_start_time(), clip.get_end_time(), clip.get_looping(), sample_time);
+		Entry* entry;
+		if (!find({ &clip, &skeleton, skeleton.get_rest_pose().get_version(), frame }, entry)) {
+			reset_pose(*entry, skeleton);
+			clip.sample(entry->pose, sample_time);
+			update_skin_matrices(*entry, skeleton);
+			entry->ready.store(true, std::memory_order_release);
+		}
+		else {
+			wait_until_ready(*entry);
+		}
+		return *entry;
+	}
+
+	// Start a new frame: the stats are reset and the poses of the last frame can be dropped
+	void new_frame();
+	// Drop all the poses (e.g. when a clip or a skeleton is deleted)
+	void clear();
+
+	unsigned int size() const;
+	unsigned int get_capacity() const;
+	void set_capacity(unsigned int capacity);
+	float get_time_step() const;
+	// Changing the quantization drops the cached poses
+	void set_time_step(float time_step);
+
+	// Lookups of the last frame that found the pose cached, and the ones that sampled it
+	unsigned int get_hits() const;
+	unsigned int get_misses() const;
+	// Hits / lookups of the last frame (0 without lookups)
+	float get_hit_rate() const;
+};
\ No newline at end of file
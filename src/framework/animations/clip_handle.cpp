@@ -0,0 +1,85 @@
+#include "clip_handle.h"
+
+ClipHandle::ClipHandle() {}
+
+ClipHandle::ClipHandle(std::nullptr_t) {}
+
+ClipHandle::ClipHandle(const Clip* clip) : type(clip ? CLIP : NONE), clip(clip) {}
+
+ClipHandle::ClipHandle(const CompressedClip* clip) : type(clip ? COMPRESSED : NONE), clip(clip) {}
+
+ClipHandle::ClipHandle(const BakedClip* clip) : type(clip ? BAKED : NONE), clip(clip) {}
+
+ClipHandle::Type ClipHandle::get_type() const
+{
+	return type;
+}
+
+const void* ClipHandle::get() const
+{
+	return clip;
+}
+
+ClipHandle::operator bool() const
+{
+	return type != NONE;
+}
+
+const std::string& ClipHandle::get_name() const
+{
+	return visit([](const auto& c) -> const std::string& { return c.get_name(); });
+}
+
+float ClipHandle::get_start_time() const
+{
+	return visit([](const auto& c) { return c.get_start_time(); });
+}
+
+float ClipHandle::get_end_time() const
+{
+	return visit([](const auto& c) { return c.get_end_time(); });
+}
+
+float ClipHandle::get_duration() const
+{
+	return visit([](const auto& c) { return c.get_duration(); });
+}
+
+bool ClipHandle::get_looping() const
+{
+	return visit([](const auto& c) { return c.get_looping(); });
+}
+
+float ClipHandle::adjust_time(float time) const
+{
+	return visit([time](const auto& c) { return c.adjust_time(time); });
+}
+
+float ClipHandle::sample(Pose& pose, float time) const
+{
+	return visit([&](const auto& c) { return c.sample(pose, time); });
+}
+
+float ClipHandle::sample(Pose& pose, float time, ClipCursor& cursor) const
+{
+	switch (type) {
+	case CLIP:
+		return static_cast<const Clip*>(clip)->sample(pose, time, cursor);
+	case COMPRESSED:
+		return static_cast<const CompressedClip*>(clip)->sample(pose, time, cursor);
+	default:
+		return sample(pose, time);
+	}
+}
+
+float ClipHandle::sample(Pose& pose, float time, ClipCursor& cursor, const std::vector<unsigned char>& joint_mask) const
+{
+	switch (type) {
+	case CLIP:
+		return static_cast<const Clip*>(clip)->sample(pose, time, cursor, joint_mask);
+	case COMPRESSED:
+		return static_cast<const CompressedClip*>(clip)->sample(pose, time, cursor);
+	default:
+		return sample(pose, time);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "clip.h"
+#include "compressed_clip.h"
+#include "baked_clip.h"
+
+// Clip of any type (Clip, CompressedClip or BakedClip) played by an entity. It does not own the clip
+class ClipHandle
+{
+public:
+	enum Type { NONE, CLIP, COMPRESSED, BAKED };
+
+protected:
+	Type type = NONE;
+	const void* clip = nullptr;
+
+public:
+	ClipHandle(); // No clip
+	ClipHandle(std::nullptr_t);
+	ClipHandle(const Clip* clip);
+	ClipHandle(const CompressedClip* clip);
+	ClipHandle(const BakedClip* clip);
+
+	Type get_type() const;
+	const void* get() const;
+	explicit operator bool() const;
+
+	// Call f with the clip as its own type (e.g. to use the templates of ClipCache). The handle must not be empty
+	template <typename Function>
+	decltype(auto) visit(Function&& f) const
+	{
+		switch (type) {
+		case COMPRESSED:
+			return f(*static_cast<const CompressedClip*>(clip));
+		case BAKED:
+			return f(*static_cast<const BakedClip*>(clip));
+		default:
+			return f(*static_cast<const Clip*>(clip));
+		}
+	}
+
+	const std::string& get_name() const;
+	float get_start_time() const;
+	float get_end_time() const;
+	float get_duration() const;
+	bool get_looping() const;
+
+	float adjust_time(float time) const;
+	// Set the local transform of the animated joints of the pose at the given playback time. Returns the time of the clip
+	float sample(Pose& pose, float time) const;
+	// Same, continuing from the keys of the last sample with the cursor (used by Clip and CompressedClip), for the players
+	float sample(Pose& pose, float time, ClipCursor& cursor) const;
+	// Same, only for the joints with a non zero value in the mask if the clip supports it (only Clip does, the others sample
+	// every joint)
+	float sample(Pose& pose, float time, ClipCursor& cursor, const std::vector<unsigned char>& joint_mask) const;
+};
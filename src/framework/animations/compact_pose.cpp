@@ -0,0 +1,292 @@
+#include "compact_pose.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// the three smallest components of a unit quaternion are in [-1/sqrt(2), 1/sqrt(2)]
+#define ROTATION_MAX 0.70710678f
+#define ROTATION_STEP (2.f * ROTATION_MAX / 32767.f)
+#define POSITION_STEPS 65535.f
+
+// streams are padded to a multiple of the widest SIMD block
+static unsigned int padded_stride(unsigned int size)
+{
+	return (size + 7) / 8 * 8;
+}
+
+static uint16_t quantize_rotation(float v)
+{
+	float u = roundf((v + ROTATION_MAX) / ROTATION_STEP);
+	return (uint16_t)std::clamp(u, 0.f, 32767.f);
+}
+
+void encode_rotation(const quat& rotation, uint16_t* words)
+{
+	// drop the largest component (recovered from the unit length), made positive as q and -q are the same rotation
+	quat q = normalized(rotation);
+	unsigned int largest = 0;
+	for (unsigned int c = 1; c < 4; c++) {
+		if (fabsf(q.v[c]) > fabsf(q.v[largest])) {
+			largest = c;
+		}
+	}
+	if (q.v[largest] < 0.f) {
+		q = -q;
+	}
+	for (unsigned int c = 0, n = 0; c < 4; c++) {
+		if (c != largest) {
+			words[n++] = quantize_rotation(q.v[c]);
+		}
+	}
+	words[0] |= (largest & 1) << 15;
+	words[1] |= (largest >> 1) << 15;
+}
+
+quat decode_rotation(const uint16_t* words)
+{
+	unsigned int largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+	float a = (words[0] & 0x7fff) * ROTATION_STEP - ROTATION_MAX;
+	float b = (words[1] & 0x7fff) * ROTATION_STEP - ROTATION_MAX;
+	float c = words[2] * ROTATION_STEP - ROTATION_MAX;
+	float d = sqrtf(std::max(1.f - a * a - b * b - c * c, 0.f));
+
+	// a, b and c are the other components in order
+	quat q;
+	q.v[largest] = d;
+	q.v[largest == 0 ? 1 : 0] = a;
+	q.v[largest <= 1 ? 2 : 1] = b;
+	q.v[largest <= 2 ? 3 : 2] = c;
+	return q;
+}
+
+void CompactPose::resize(unsigned int size)
+{
+	num_joints = size;
+	stride = padded_stride(size);
+	data.assign(6 * stride, 0);
+}
+
+unsigned int CompactPose::size() const
+{
+	return num_joints;
+}
+
+size_t CompactPose::get_bytes() const
+{
+	return data.size() * sizeof(uint16_t);
+}
+
+const uint16_t* CompactPose::get_stream(unsigned int i) const
+{
+	return data.data() + i * stride;
+}
+
+uint16_t* CompactPose::get_stream(unsigned int i)
+{
+	return data.data() + i * stride;
+}
+
+CompactPoseFormat::CompactPoseFormat() { }
+
+CompactPoseFormat::CompactPoseFormat(Pose& rest_pose, float margin)
+{
+	num_joints = rest_pose.size();
+	rig = rest_pose.get_rig();
+
+	const std::vector<Transform>& joints = rest_pose.get_local_transforms();
+	position_min.resize(num_joints);
+	position_max.resize(num_joints);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		position_min[i] = joints[i].position - vec3(margin, margin, margin);
+		position_max[i] = joints[i].position + vec3(margin, margin, margin);
+	}
+
+	unsigned int stride = padded_stride(num_joints);
+	scale_x.assign(stride, 1.f); scale_y.assign(stride, 1.f); scale_z.assign(stride, 1.f);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		scale_x[i] = joints[i].scale.x; scale_y[i] = joints[i].scale.y; scale_z[i] = joints[i].scale.z;
+	}
+
+	update_steps();
+	reset_errors();
+}
+
+unsigned int CompactPoseFormat::size() const
+{
+	return num_joints;
+}
+
+void CompactPoseFormat::update_steps()
+{
+	unsigned int stride = padded_stride(num_joints);
+	min_x.assign(stride, 0.f); min_y.assign(stride, 0.f); min_z.assign(stride, 0.f);
+	step_x.assign(stride, 0.f); step_y.assign(stride, 0.f); step_z.assign(stride, 0.f);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		min_x[i] = position_min[i].x; min_y[i] = position_min[i].y; min_z[i] = position_min[i].z;
+		step_x[i] = (position_max[i].x - position_min[i].x) / POSITION_STEPS;
+		step_y[i] = (position_max[i].y - position_min[i].y) / POSITION_STEPS;
+		step_z[i] = (position_max[i].z - position_min[i].z) / POSITION_STEPS;
+	}
+}
+
+void CompactPoseFormat::include(Pose& pose, float margin)
+{
+	if (pose.size() != num_joints) {
+		std::cout << "[Warning] The pose does not have the same number of joints as the compact pose format" << std::endl;
+		return;
+	}
+
+	const std::vector<Transform>& joints = pose.get_local_transforms();
+	for (unsigned int i = 0; i < num_joints; i++) {
+		const vec3& p = joints[i].position;
+		position_min[i] = vec3(std::min(position_min[i].x, p.x - margin), std::min(position_min[i].y, p.y - margin), std::min(position_min[i].z, p.z - margin));
+		position_max[i] = vec3(std::max(position_max[i].x, p.x + margin), std::max(position_max[i].y, p.y + margin), std::max(position_max[i].z, p.z + margin));
+	}
+	update_steps();
+}
+
+void CompactPoseFormat::encode(Pose& pose, CompactPose& out)
+{
+	if (pose.size() != num_joints) {
+		std::cout << "[Warning] The pose does not have the same number of joints as the compact pose format" << std::endl;
+		return;
+	}
+
+	out.resize(num_joints);
+	const std::vector<Transform>& joints = pose.get_local_transforms();
+	for (unsigned int i = 0; i < num_joints; i++) {
+		uint16_t words[3];
+		encode_rotation(joints[i].rotation, words);
+
+		// position: fixed point in the range of the joint
+		const vec3& p = joints[i].position;
+		float steps[3] = { step_x[i], step_y[i], step_z[i] };
+		float mins[3] = { min_x[i], min_y[i], min_z[i] };
+		float values[3] = { p.x, p.y, p.z };
+		vec3 decoded_position;
+		for (unsigned int c = 0; c < 3; c++) {
+			uint16_t value = 0;
+			if (steps[c] > 0.f) {
+				value = (uint16_t)std::clamp(roundf((values[c] - mins[c]) / steps[c]), 0.f, POSITION_STEPS);
+			}
+			out.get_stream(3 + c)[i] = value;
+			decoded_position.v[c] = mins[c] + value * steps[c];
+		}
+		for (unsigned int c = 0; c < 3; c++) {
+			out.get_stream(c)[i] = words[c];
+		}
+
+		// angle between unit quaternions from their chord (acos of the dot product is too imprecise for small angles)
+		quat q = normalized(joints[i].rotation);
+		quat decoded_rotation = decode_rotation(words);
+		if (dot(q, decoded_rotation) < 0.f) {
+			q = -q;
+		}
+		float chord = sqrtf(len_sq(decoded_rotation - q));
+		float angle = 4.f * asinf(std::min(chord * 0.5f, 1.f));
+		max_rotation_error[i] = std::max(max_rotation_error[i], angle);
+		max_position_error[i] = std::max(max_position_error[i], sqrtf(len_sq(decoded_position - p)));
+	}
+}
+
+simd_transform CompactPoseFormat::decode_block(const CompactPose& pose, unsigned int k) const
+{
+	const simd_float high_bit = simd_set1(32768.f);
+	const simd_float step = simd_set1(ROTATION_STEP);
+	const simd_float offset = simd_set1(-ROTATION_MAX);
+
+	// the high bits of the first two words are the index of the largest component
+	simd_float w0 = simd_load_u16(pose.get_stream(0) + k);
+	simd_float w1 = simd_load_u16(pose.get_stream(1) + k);
+	simd_float w2 = simd_load_u16(pose.get_stream(2) + k);
+	simd_float h0 = simd_greater_equal(w0, high_bit);
+	simd_float h1 = simd_greater_equal(w1, high_bit);
+	simd_float a = simd_madd(simd_sub(w0, simd_and(h0, high_bit)), step, offset);
+	simd_float b = simd_madd(simd_sub(w1, simd_and(h1, high_bit)), step, offset);
+	simd_float c = simd_madd(w2, step, offset);
+	simd_float d = simd_sub(simd_set1(1.f), simd_madd(a, a, simd_madd(b, b, simd_mul(c, c))));
+	d = simd_sqrt(simd_max(d, simd_set1(0.f)));
+
+	// a, b and c are the other components in order: insert d at the index (h0 + 2 * h1)
+	simd_transform block;
+	block.rx = simd_select(h1, a, simd_select(h0, a, d));
+	block.ry = simd_select(h1, b, simd_select(h0, d, a));
+	block.rz = simd_select(h1, simd_select(h0, c, d), b);
+	block.rw = simd_select(h1, simd_select(h0, d, c), c);
+
+	block.px = simd_madd(simd_load_u16(pose.get_stream(3) + k), simd_load(&step_x[k]), simd_load(&min_x[k]));
+	block.py = simd_madd(simd_load_u16(pose.get_stream(4) + k), simd_load(&step_y[k]), simd_load(&min_y[k]));
+	block.pz = simd_madd(simd_load_u16(pose.get_stream(5) + k), simd_load(&step_z[k]), simd_load(&min_z[k]));
+
+	block.sx = simd_load(&scale_x[k]); block.sy = simd_load(&scale_y[k]); block.sz = simd_load(&scale_z[k]);
+	return block;
+}
+
+void CompactPoseFormat::decode(const CompactPose& pose, Pose& out) const
+{
+	if (pose.size() != num_joints) {
+		std::cout << "[Warning] The compact pose does not have the same number of joints as its format" << std::endl;
+		return;
+	}
+	if (out.size() != num_joints) {
+		out.resize(num_joints);
+		out.set_rig(rig);
+	}
+
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		store_to_pose(decode_block(pose, k), k, std::min((unsigned int)SIMD_WIDTH, num_joints - k), nullptr, out);
+	}
+}
+
+void CompactPoseFormat::decode(const CompactPose& pose, TransformStreams& out) const
+{
+	if (pose.size() != num_joints) {
+		std::cout << "[Warning] The compact pose does not have the same number of joints as its format" << std::endl;
+		return;
+	}
+
+	// the streams are padded, so full blocks can be stored
+	out.resize(num_joints);
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		out.store_block(k, decode_block(pose, k));
+	}
+}
+
+void CompactPoseFormat::decode(const CompactPose& pose, PoseSoA& out) const
+{
+	if (pose.size() != num_joints || out.size() != num_joints) {
+		std::cout << "[Warning] The compact pose does not have the same number of joints as its format" << std::endl;
+		return;
+	}
+
+	const std::vector<unsigned int>& soa_ids = out.get_soa_ids();
+	TransformStreams& locals = out.edit_local_streams();
+	alignas(SIMD_ALIGNMENT) float lanes[10][SIMD_WIDTH];
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		store_lanes(decode_block(pose, k), lanes);
+		unsigned int block_size = std::min((unsigned int)SIMD_WIDTH, num_joints - k);
+		for (unsigned int lane = 0; lane < block_size; lane++) {
+			unsigned int id = soa_ids[k + lane];
+			locals.px[id] = lanes[0][lane]; locals.py[id] = lanes[1][lane]; locals.pz[id] = lanes[2][lane];
+			locals.rx[id] = lanes[3][lane]; locals.ry[id] = lanes[4][lane]; locals.rz[id] = lanes[5][lane]; locals.rw[id] = lanes[6][lane];
+			locals.sx[id] = lanes[7][lane]; locals.sy[id] = lanes[8][lane]; locals.sz[id] = lanes[9][lane];
+		}
+	}
+}
+
+float CompactPoseFormat::get_max_position_error(unsigned int id) const
+{
+	return max_position_error[id];
+}
+
+float CompactPoseFormat::get_max_rotation_error(unsigned int id) const
+{
+	return max_rotation_error[id];
+}
+
+void CompactPoseFormat::reset_errors()
+{
+	max_position_error.assign(num_joints, 0.f);
+	max_rotation_error.assign(num_joints, 0.f);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "pose.h"
+#include "pose_soa.h"
+
+// Smallest three encoding of a unit quaternion in 3 words (48 bits), see CompactPose
+void encode_rotation(const quat& rotation, uint16_t* words);
+quat decode_rotation(const uint16_t* words);
+
+// Local transforms of a pose quantized to 12 bytes per joint (a Transform takes 40), to keep many poses in memory:
+// - rotation: smallest three components of the quaternion with 15 bits each, plus 2 bits for the index of the largest one (48 bits)
+// - position: 16 bits per component, relative to the range of the joint in its CompactPoseFormat
+// - scale: not stored, the rest scale of the joint is used
+// Each of the 6 words is stored as a stream padded to a multiple of 8 joints, so they can be decoded with SIMD
+struct CompactPose
+{
+	unsigned int num_joints = 0;
+	unsigned int stride = 0;	// padded number of joints of each stream
+	std::vector<uint16_t> data;	// rotation words (3 streams) followed by position words (3 streams)
+
+	void resize(unsigned int size);
+	unsigned int size() const;
+	// Memory used by the encoded transforms
+	size_t get_bytes() const;
+
+	const uint16_t* get_stream(unsigned int i) const;
+	uint16_t* get_stream(unsigned int i);
+};
+
+// Quantization ranges of the joints of a skeleton, shared by all its compact poses
+// The position range of every joint is fitted to the poses it will encode. Changing the ranges invalidates the poses already encoded
+class CompactPoseFormat
+{
+protected:
+	unsigned int num_joints = 0;
+	std::shared_ptr<const Rig> rig;
+
+	std::vector<vec3> position_min;
+	std::vector<vec3> position_max;
+	// streams used to decode (padded to a multiple of 8 joints): position = min + value * step
+	aligned_vector<float> min_x, min_y, min_z;
+	aligned_vector<float> step_x, step_y, step_z;
+	aligned_vector<float> scale_x, scale_y, scale_z;
+
+	// largest error measured while encoding, for each joint (local space)
+	std::vector<float> max_position_error;
+	std::vector<float> max_rotation_error;
+
+	void update_steps();
+	simd_transform decode_block(const CompactPose& pose, unsigned int k) const;
+
+public:
+	CompactPoseFormat(); // Empty format
+	// Initialize the format with the hierarchy and the rest scale of the pose, and a position range around its positions
+	CompactPoseFormat(Pose& rest_pose, float margin = 0.f);
+
+	unsigned int size() const;
+
+	// Extend the position ranges to include the positions of the pose (plus a margin)
+	void include(Pose& pose, float margin = 0.f);
+
+	// Quantize the local transforms of the pose (positions out of the range are clamped) and update the measured errors
+	void encode(Pose& pose, CompactPose& out);
+	// Decode the transforms into the pose (it gets the hierarchy of the format if it has a different number of joints)
+	void decode(const CompactPose& pose, Pose& out) const;
+	// Decode the transforms in joint order
+	void decode(const CompactPose& pose, TransformStreams& out) const;
+	// Decode the transforms directly into the local streams of a pose of the same skeleton
+	void decode(const CompactPose& pose, PoseSoA& out) const;
+
+	// Largest distance (in local space) between an encoded position and its decoded value so far
+	float get_max_position_error(unsigned int id) const;
+	// Largest angle (radians) between an encoded rotation and its decoded value so far
+	float get_max_rotation_error(unsigned int id) const;
+	void reset_errors();
+};
\ No newline at end of file
@@ -0,0 +1,597 @@
+#include "compressed_clip.h"
+#include "compact_pose.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+std::atomic<uint64_t> CompressedClip::last_id = 0;
+
+#define CUBIC_SUBDIVISIONS 4		// samples per key of the cubic tracks, which are stored as linear
+#define MAX_REMOVED_KEYS 256		// longest run of removed keys, bounds the cost of the reduction
+#define QUANTIZATION_SHARE 0.25f	// part of the tolerance of a track for the quantization, the rest is for the key reduction
+#define MIN_TOLERANCE_SCALE 0.0625f	// smallest tolerance of a joint (relative to the given one) before all its keys are kept
+#define MAX_SUBDIVISIONS 64			// most samples per key of the cubic tracks of the joints that need more precision
+#define MAX_ATTEMPTS 16				// times the joints over their tolerance are compressed again more precisely
+
+// decode the keys around the time. Out of the keys the first or the last one is used
+template <typename CompressedTrack, typename T>
+static void decode_segment(const CompressedTrack& track, float time, unsigned int& cursor, DecodedSegment& segment, T& from, T& to)
+{
+	unsigned int num_keys = track.size();
+	if (num_keys == 0) {
+		from = to = T();
+		segment = { -FLT_MAX, FLT_MAX, 0.0f };
+	}
+	else if (num_keys == 1 || time < track.times[0]) {
+		from = to = track.get_value(0);
+		segment = { -FLT_MAX, num_keys == 1 ? FLT_MAX : track.times[0], 0.0f };
+	}
+	else if (time >= track.times[num_keys - 1]) {
+		from = to = track.get_value(num_keys - 1);
+		segment = { track.times[num_keys - 1], FLT_MAX, 0.0f };
+	}
+	else {
+		unsigned int k = find_key(track.times, time, cursor);
+		from = track.get_value(k);
+		to = track.get_value(k + 1);
+		float duration = track.times[k + 1] - track.times[k];
+		bool constant = track.interpolation == Interpolation::Constant || duration <= 0.0f;
+		segment = { track.times[k], track.times[k + 1], constant ? 0.0f : 1.0f / duration };
+	}
+}
+
+// same as Track::sample. While the time stays in the decoded segment (most samples when playing) it only interpolates its keys
+template <typename CompressedTrack, typename T>
+static T sample_track(const CompressedTrack& track, float time, unsigned int& cursor, DecodedSegment& segment, T& from, T& to)
+{
+	if (!(time >= segment.start && time < segment.end)) {
+		decode_segment(track, time, cursor, segment, from, to);
+	}
+	if (segment.inv_duration == 0.0f) {
+		return from;
+	}
+	return interpolate(from, to, (time - segment.start) * segment.inv_duration);
+}
+
+unsigned int CompressedVec3Track::size() const
+{
+	return (unsigned int)times.size();
+}
+
+size_t CompressedVec3Track::get_bytes() const
+{
+	return times.size() * sizeof(float) + values.size() * sizeof(uint16_t) + full_values.size() * sizeof(vec3);
+}
+
+vec3 CompressedVec3Track::get_value(unsigned int key) const
+{
+	if (!full_values.empty()) {
+		return full_values[key];
+	}
+	const uint16_t* v = &values[key * 3];
+	return min + vec3((float)v[0], (float)v[1], (float)v[2]) * step;
+}
+
+vec3 CompressedVec3Track::sample(float time, unsigned int& cursor, DecodedSegment& segment, vec3& from, vec3& to) const
+{
+	return sample_track(*this, time, cursor, segment, from, to);
+}
+
+unsigned int CompressedQuatTrack::size() const
+{
+	return (unsigned int)times.size();
+}
+
+size_t CompressedQuatTrack::get_bytes() const
+{
+	return times.size() * sizeof(float) + values.size() * sizeof(uint16_t) + full_values.size() * sizeof(quat);
+}
+
+quat CompressedQuatTrack::get_value(unsigned int key) const
+{
+	if (!full_values.empty()) {
+		return full_values[key];
+	}
+	return decode_rotation(&values[key * 3]);
+}
+
+quat CompressedQuatTrack::sample(float time, unsigned int& cursor, DecodedSegment& segment, quat& from, quat& to) const
+{
+	return sample_track(*this, time, cursor, segment, from, to);
+}
+
+Transform CompressedTransformTrack::sample(const Transform& reference, float time, unsigned int* cursors, DecodedSegment* segments, Transform& from, Transform& to) const
+{
+	Transform result = reference;
+	if (position.size() > 0) result.position = position.sample(time, cursors[0], segments[0], from.position, to.position);
+	if (rotation.size() > 0) result.rotation = rotation.sample(time, cursors[1], segments[1], from.rotation, to.rotation);
+	if (scale.size() > 0) result.scale = scale.sample(time, cursors[2], segments[2], from.scale, to.scale);
+	return result;
+}
+
+CompressedClip::CompressedClip() { }
+
+CompressedClip::CompressedClip(const std::string& name, std::vector<CompressedTransformTrack>&& tracks, float start_time, float end_time, bool looping)
+{
+	this->name = name;
+	this->tracks = std::move(tracks);
+	this->start_time = start_time;
+	this->end_time = end_time;
+	this->looping = looping;
+}
+
+const std::string& CompressedClip::get_name() const
+{
+	return name;
+}
+
+unsigned int CompressedClip::size() const
+{
+	return (unsigned int)tracks.size();
+}
+
+const CompressedTransformTrack& CompressedClip::get_track(unsigned int index) const
+{
+	return tracks[index];
+}
+
+size_t CompressedClip::get_bytes() const
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		bytes += tracks[i].position.get_bytes() + tracks[i].rotation.get_bytes() + tracks[i].scale.get_bytes();
+	}
+	return bytes;
+}
+
+float CompressedClip::get_start_time() const
+{
+	return start_time;
+}
+
+float CompressedClip::get_end_time() const
+{
+	return end_time;
+}
+
+float CompressedClip::get_duration() const
+{
+	return end_time - start_time;
+}
+
+bool CompressedClip::get_looping() const
+{
+	return looping;
+}
+
+void CompressedClip::set_looping(bool looping)
+{
+	this->looping = looping;
+}
+
+float CompressedClip::adjust_time(float time) const
+{
+	return ::adjust_time(time, start_time, end_time, looping);
+}
+
+float CompressedClip::sample(Pose& pose, float time, ClipCursor& cursor) const
+{
+	time = adjust_time(time);
+	cursor.keys.resize(tracks.size() * 3, 0);
+	// the decoded keys are only valid for the clip that decoded them
+	if (cursor.decoded_clip_id != id || cursor.decoded_segments.size() != tracks.size() * 3) {
+		cursor.decoded_clip_id = id;
+		cursor.decoded_segments.assign(tracks.size() * 3, DecodedSegment());
+		cursor.decoded_from.resize(tracks.size());
+		cursor.decoded_to.resize(tracks.size());
+	}
+
+	unsigned int num_joints = pose.size();
+	for (unsigned int i = 0; i < tracks.size(); i++) {
+		unsigned int joint_id = tracks[i].joint_id;
+		if (joint_id < num_joints) {
+			Transform transform = tracks[i].sample(pose.get_local_transform(joint_id), time, &cursor.keys[i * 3], &cursor.decoded_segments[i * 3], cursor.decoded_from[i], cursor.decoded_to[i]);
+			pose.set_local_transform(joint_id, transform);
+		}
+	}
+	return time;
+}
+
+float CompressedClip::sample(Pose& pose, float time) const
+{
+	ClipCursor cursor;
+	return sample(pose, time, cursor);
+}
+
+// the keys of a track as linear keys: the same keys, or samples of the curve if it is cubic
+template <typename T>
+static Interpolation get_linear_keys(const Track<T>& track, unsigned int subdivisions, std::vector<float>& times, std::vector<T>& values)
+{
+	if (track.get_interpolation() != Interpolation::Cubic) {
+		times = track.get_times();
+		values = track.get_values();
+		return track.get_interpolation();
+	}
+
+	const std::vector<float>& keys = track.get_times();
+	times.clear();
+	values.clear();
+	unsigned int cursor = 0;
+	for (unsigned int k = 0; k + 1 < keys.size(); k++) {
+		for (unsigned int s = 0; s < subdivisions; s++) {
+			float time = keys[k] + (keys[k + 1] - keys[k]) * s / subdivisions;
+			times.push_back(time);
+			values.push_back(track.sample(time, cursor));
+		}
+	}
+	if (!keys.empty()) {
+		times.push_back(keys.back());
+		values.push_back(track.get_values().back());
+	}
+	return Interpolation::Linear;
+}
+
+// Get the keys to keep so interpolating the kept keys is within the tolerance of all the keys. error(a, b) is the distance between two values
+template <typename T, typename Error>
+static std::vector<unsigned int> reduce_keys(const std::vector<float>& times, const std::vector<T>& values, Interpolation interpolation, float tolerance, Error error)
+{
+	std::vector<unsigned int> kept;
+	unsigned int num_keys = (unsigned int)times.size();
+	if (num_keys == 0) {
+		return kept;
+	}
+	kept.push_back(0);
+
+	// a constant track needs a single key
+	bool constant = true;
+	for (unsigned int k = 1; k < num_keys && constant; k++) {
+		constant = error(values[0], values[k]) <= tolerance;
+	}
+	if (constant) {
+		return kept;
+	}
+
+	// extend the segment from the last kept key while the keys inside it can be interpolated from its ends
+	unsigned int anchor = 0;
+	for (unsigned int end = 2; end < num_keys; end++) {
+		bool fits = end - anchor <= MAX_REMOVED_KEYS;
+		for (unsigned int k = anchor + 1; k < end && fits; k++) {
+			T value = values[anchor];
+			if (interpolation != Interpolation::Constant) {
+				float t = (times[k] - times[anchor]) / (times[end] - times[anchor]);
+				value = interpolate(values[anchor], values[end], t);
+			}
+			fits = error(value, values[k]) <= tolerance;
+		}
+		if (!fits) {
+			anchor = end - 1;
+			kept.push_back(anchor);
+		}
+	}
+	kept.push_back(num_keys - 1);
+	return kept;
+}
+
+static void quantize_keys(const std::vector<float>& times, const std::vector<vec3>& values, const std::vector<unsigned int>& kept, Interpolation interpolation, bool full_precision, CompressedVec3Track& out)
+{
+	out = CompressedVec3Track();
+	out.interpolation = interpolation;
+	if (kept.empty()) {
+		return;
+	}
+	out.times.reserve(kept.size());
+	for (unsigned int k : kept) {
+		out.times.push_back(times[k]);
+	}
+	if (full_precision) {
+		out.full_values.reserve(kept.size());
+		for (unsigned int k : kept) {
+			out.full_values.push_back(values[k]);
+		}
+		return;
+	}
+
+	vec3 min = values[kept[0]];
+	vec3 max = min;
+	for (unsigned int k : kept) {
+		min = vec3(std::min(min.x, values[k].x), std::min(min.y, values[k].y), std::min(min.z, values[k].z));
+		max = vec3(std::max(max.x, values[k].x), std::max(max.y, values[k].y), std::max(max.z, values[k].z));
+	}
+	out.min = min;
+	out.step = (max - min) / 65535.0f;
+
+	out.values.reserve(kept.size() * 3);
+	for (unsigned int k : kept) {
+		for (unsigned int c = 0; c < 3; c++) {
+			float value = out.step.v[c] > 0.0f ? roundf((values[k].v[c] - min.v[c]) / out.step.v[c]) : 0.0f;
+			out.values.push_back((uint16_t)std::clamp(value, 0.0f, 65535.0f));
+		}
+	}
+}
+
+static void quantize_keys(const std::vector<float>& times, const std::vector<quat>& values, const std::vector<unsigned int>& kept, Interpolation interpolation, bool full_precision, CompressedQuatTrack& out)
+{
+	out = CompressedQuatTrack();
+	out.interpolation = interpolation;
+	out.times.reserve(kept.size());
+	for (unsigned int k : kept) {
+		out.times.push_back(times[k]);
+	}
+	if (full_precision) {
+		out.full_values.reserve(kept.size());
+		for (unsigned int k : kept) {
+			out.full_values.push_back(values[k]);
+		}
+		return;
+	}
+	out.values.resize(kept.size() * 3);
+	for (unsigned int i = 0; i < kept.size(); i++) {
+		encode_rotation(values[kept[i]], &out.values[i * 3]);
+	}
+}
+
+static float distance(const vec3& a, const vec3& b)
+{
+	return sqrtf(len_sq(a - b));
+}
+
+// angle between two rotations, precise for small angles
+static float angle_between(const quat& a, const quat& b)
+{
+	quat c = dot(a, b) < 0.0f ? -b : b;
+	return 4.0f * asinf(std::min(sqrtf(len_sq(a - c)) * 0.5f, 1.0f));
+}
+
+// how precisely the tracks of a joint are compressed, raised for the joints that exceed their tolerance (see compress_clip)
+struct TrackPrecision
+{
+	float tolerance_scale = 1.0f;	// of the tolerance of the joint
+	bool lossless = false;	// keep the keys that are not exactly interpolated, as floats
+	unsigned int subdivisions = CUBIC_SUBDIVISIONS;
+};
+
+// a smaller tolerance, then lossless, then more samples of the cubic tracks. Returns false if it cannot be more precise
+static bool raise_precision(TrackPrecision& precision)
+{
+	if (precision.tolerance_scale > MIN_TOLERANCE_SCALE) {
+		precision.tolerance_scale *= 0.5f;
+	}
+	else if (!precision.lossless) {
+		precision.lossless = true;
+	}
+	else if (precision.subdivisions < MAX_SUBDIVISIONS) {
+		precision.subdivisions *= 2;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+// reduce and quantize the keys of a track. The error of the values is scaled to a world distance (see compress_clip)
+// The kept keys are stored as floats if the quantization alone takes more than its share of the tolerance
+template <typename T, typename CompressedTrack>
+static void compress_track(const Track<T>& track, float tolerance, float error_scale, const TrackPrecision& precision, CompressedTrack& out)
+{
+	std::vector<float> times;
+	std::vector<T> values;
+	Interpolation interpolation = get_linear_keys(track, precision.subdivisions, times, values);
+
+	auto error = [error_scale](const T& a, const T& b) {
+		if constexpr (std::is_same<T, quat>::value) {
+			return angle_between(a, b) * error_scale;
+		}
+		else {
+			return distance(a, b) * error_scale;
+		}
+	};
+	std::vector<unsigned int> kept = reduce_keys(times, values, interpolation, precision.lossless ? 0.0f : tolerance * (1.0f - QUANTIZATION_SHARE), error);
+
+	bool full_precision = precision.lossless;
+	if (!full_precision) {
+		quantize_keys(times, values, kept, interpolation, false, out);
+		float quantization_error = 0.0f;
+		for (unsigned int i = 0; i < kept.size(); i++) {
+			quantization_error = std::max(quantization_error, error(out.get_value(i), values[kept[i]]));
+		}
+		full_precision = quantization_error > tolerance * QUANTIZATION_SHARE;
+	}
+	if (full_precision) {
+		quantize_keys(times, values, kept, interpolation, true, out);
+	}
+}
+
+// world position of the joint and of the points around it at the shell distance
+static void get_shell_points(const Transform& world, float shell_distance, vec3* points)
+{
+	points[0] = world.position;
+	points[1] = transform_point(world, vec3(shell_distance, 0.0f, 0.0f));
+	points[2] = transform_point(world, vec3(0.0f, shell_distance, 0.0f));
+	points[3] = transform_point(world, vec3(0.0f, 0.0f, shell_distance));
+}
+
+// times to measure the error at: the keys of the original clip and, for the cubic tracks, twice as often as they are resampled
+// (at the resampled keys and halfway between them, where the linear keys are farthest from the curve)
+template <typename T>
+static void add_measure_times(const Track<T>& track, unsigned int subdivisions, std::vector<float>& times)
+{
+	const std::vector<float>& keys = track.get_times();
+	times.insert(times.end(), keys.begin(), keys.end());
+	if (track.get_interpolation() == Interpolation::Cubic) {
+		for (unsigned int k = 0; k + 1 < keys.size(); k++) {
+			for (unsigned int s = 1; s < subdivisions * 2; s++) {
+				times.push_back(keys[k] + (keys[k + 1] - keys[k]) * s / (subdivisions * 2));
+			}
+		}
+	}
+}
+
+// largest world distance of every joint between the original and the compressed clip (errors), and the part of it added by the track
+// of the joint: the distance when its compressed transform is applied to the original transform of its parent (own_errors)
+static void measure_errors(const Clip& clip, const CompressedClip& compressed, Pose& rest_pose, float shell_distance,
+	const std::vector<TrackPrecision>& precisions, std::vector<float>& errors, std::vector<float>& own_errors)
+{
+	unsigned int num_joints = rest_pose.size();
+	std::vector<float> times;
+	for (unsigned int i = 0; i < clip.size(); i++) {
+		const TransformTrack& track = clip.get_track(i);
+		unsigned int subdivisions = track.joint_id < num_joints ? precisions[track.joint_id].subdivisions : CUBIC_SUBDIVISIONS;
+		add_measure_times(track.position, subdivisions, times);
+		add_measure_times(track.rotation, subdivisions, times);
+		add_measure_times(track.scale, subdivisions, times);
+	}
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	errors.assign(num_joints, 0.0f);
+	own_errors.assign(num_joints, 0.0f);
+	Pose original = rest_pose;
+	Pose result = rest_pose;
+	std::vector<unsigned int> original_cursors(clip.size() * 3, 0);
+	ClipCursor result_cursor;
+	std::vector<Transform> original_world, result_world;
+	for (float time : times) {
+		// the original tracks are sampled directly so a looping clip does not wrap the last key
+		for (unsigned int i = 0; i < clip.size(); i++) {
+			unsigned int joint_id = clip.get_track(i).joint_id;
+			if (joint_id < num_joints) {
+				original.set_local_transform(joint_id, clip.get_track(i).sample(rest_pose.get_local_transform(joint_id), time, &original_cursors[i * 3]));
+			}
+		}
+		compressed.sample(result, time, result_cursor);
+
+		original.get_global_transforms(original_world);
+		result.get_global_transforms(result_world);
+		for (unsigned int j = 0; j < num_joints; j++) {
+			int parent_id = original.get_parent(j);
+			Transform own_world = result.get_local_transform(j);
+			if (parent_id >= 0) {
+				own_world = combine(original_world[parent_id], own_world);
+			}
+			vec3 a[4], b[4], c[4];
+			get_shell_points(original_world[j], shell_distance, a);
+			get_shell_points(result_world[j], shell_distance, b);
+			get_shell_points(own_world, shell_distance, c);
+			for (unsigned int p = 0; p < 4; p++) {
+				errors[j] = std::max(errors[j], distance(a[p], b[p]));
+				own_errors[j] = std::max(own_errors[j], distance(a[p], c[p]));
+			}
+		}
+	}
+}
+
+template <typename T>
+static size_t get_track_bytes(const Track<T>& track)
+{
+	return track.get_times().size() * sizeof(float) + (track.get_values().size() + track.get_in_tangents().size() + track.get_out_tangents().size()) * sizeof(T);
+}
+
+CompressedClip compress_clip(const Clip& clip, Pose& rest_pose, const ClipCompressionSettings& settings, ClipCompressionStats* stats)
+{
+	unsigned int num_joints = rest_pose.size();
+	std::vector<float> tolerances(num_joints, settings.tolerance);
+	if (settings.joint_tolerances.size() == num_joints) {
+		tolerances = settings.joint_tolerances;
+	}
+
+	// reach of every joint: distance to its farthest descendant (plus the shell) in the rest pose. A rotation error of the joint
+	// moves its descendants at most angle * reach, so the errors of the rotation and scale tracks are scaled by it.
+	// The error of a joint also moves its descendants, so it must fit in the smallest tolerance of its subtree
+	std::vector<Transform> world;
+	rest_pose.get_global_transforms(world);
+	std::vector<float> reach(num_joints, settings.shell_distance);
+	std::vector<float> subtree_tolerances = tolerances;
+	for (unsigned int j = 0; j < num_joints; j++) {
+		for (int a = rest_pose.get_parent(j); a >= 0 && a < (int)num_joints; a = rest_pose.get_parent(a)) {
+			reach[a] = std::max(reach[a], distance(world[a].position, world[j].position) + settings.shell_distance);
+			subtree_tolerances[a] = std::min(subtree_tolerances[a], tolerances[j]);
+		}
+	}
+
+	// compress the tracks of the joints whose precision changed, keeping the most precise result. The error of a joint comes from
+	// its track and from the tracks of its ancestors: the joints of the chain that add the largest errors are the ones made more precise
+	std::vector<TrackPrecision> precisions(num_joints);
+	std::vector<CompressedTransformTrack> tracks(clip.size());
+	std::vector<unsigned char> changed(num_joints, 1);
+	CompressedClip result;
+	std::vector<float> errors, own_errors, best_errors;
+	float best_ratio = INFINITY; // largest error of a joint relative to its tolerance
+	for (unsigned int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+		for (unsigned int i = 0; i < clip.size(); i++) {
+			const TransformTrack& track = clip.get_track(i);
+			unsigned int joint_id = track.joint_id;
+			if (joint_id < num_joints && !changed[joint_id] && attempt > 0) {
+				continue;
+			}
+			TrackPrecision precision = joint_id < num_joints ? precisions[joint_id] : TrackPrecision();
+			float tolerance = (joint_id < num_joints ? subtree_tolerances[joint_id] : settings.tolerance) * precision.tolerance_scale;
+			float joint_reach = joint_id < num_joints ? reach[joint_id] : settings.shell_distance;
+
+			tracks[i].joint_id = joint_id;
+			compress_track(track.position, tolerance, 1.0f, precision, tracks[i].position);
+			compress_track(track.rotation, tolerance, joint_reach, precision, tracks[i].rotation);
+			compress_track(track.scale, tolerance, joint_reach, precision, tracks[i].scale);
+		}
+		// not looping while measuring, so the last key is not wrapped to the first one
+		CompressedClip compressed(clip.get_name(), std::vector<CompressedTransformTrack>(tracks), clip.get_start_time(), clip.get_end_time(), false);
+		measure_errors(clip, compressed, rest_pose, settings.shell_distance, precisions, errors, own_errors);
+
+		float ratio = 0.0f;
+		for (unsigned int j = 0; j < num_joints; j++) {
+			ratio = std::max(ratio, tolerances[j] > 0.0f ? errors[j] / tolerances[j] : (errors[j] > 0.0f ? INFINITY : 0.0f));
+		}
+		if (ratio < best_ratio) {
+			best_ratio = ratio;
+			best_errors = errors;
+			result = std::move(compressed);
+		}
+		if (ratio <= 1.0f) {
+			break;
+		}
+
+		std::fill(changed.begin(), changed.end(), 0);
+		bool any_changed = false;
+		for (unsigned int j = 0; j < num_joints; j++) {
+			if (errors[j] <= tolerances[j]) {
+				continue;
+			}
+			float largest = 0.0f;
+			for (int a = (int)j; a >= 0 && a < (int)num_joints; a = rest_pose.get_parent(a)) {
+				largest = std::max(largest, own_errors[a]);
+			}
+			for (int a = (int)j; a >= 0 && a < (int)num_joints; a = rest_pose.get_parent(a)) {
+				if (!changed[a] && own_errors[a] >= largest * 0.5f && raise_precision(precisions[a])) {
+					changed[a] = 1;
+					any_changed = true;
+				}
+			}
+		}
+		if (!any_changed) {
+			break;
+		}
+	}
+	errors = best_errors;
+	result.set_looping(clip.get_looping());
+
+	if (stats) {
+		*stats = ClipCompressionStats();
+		for (unsigned int i = 0; i < clip.size(); i++) {
+			const TransformTrack& track = clip.get_track(i);
+			stats->original_bytes += get_track_bytes(track.position) + get_track_bytes(track.rotation) + get_track_bytes(track.scale);
+			stats->original_keys += track.position.size() + track.rotation.size() + track.scale.size();
+			const CompressedTransformTrack& compressed_track = result.get_track(i);
+			stats->compressed_keys += compressed_track.position.size() + compressed_track.rotation.size() + compressed_track.scale.size();
+		}
+		stats->compressed_bytes = result.get_bytes();
+		stats->ratio = stats->compressed_bytes > 0 ? (float)stats->original_bytes / stats->compressed_bytes : 1.0f;
+		for (unsigned int j = 0; j < num_joints; j++) {
+			if (errors[j] > stats->max_error) {
+				stats->max_error = errors[j];
+				stats->max_error_joint = (int)j;
+			}
+			stats->num_failed_joints += errors[j] > tolerances[j] ? 1 : 0;
+		}
+	}
+	return result;
+}
\ No newline at end of file
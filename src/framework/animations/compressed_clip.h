@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "clip.h"
+
+// Linearly interpolated track with 16 bits per component, relative to the range of the track: value = min + quantized * step
+// The tracks the quantization cannot keep within the tolerance (e.g. a root that travels far) keep their values as floats
+struct CompressedVec3Track
+{
+	std::vector<float> times;
+	std::vector<uint16_t> values;	// 3 per key
+	std::vector<vec3> full_values;	// instead of values, if not quantized
+	vec3 min;
+	vec3 step;
+	Interpolation interpolation = Interpolation::Linear; // linear or constant
+
+	unsigned int size() const;
+	size_t get_bytes() const;
+	vec3 get_value(unsigned int key) const;
+	// Same as Track::sample. The values of the keys of the current segment are kept decoded in from and to, and only decoded again
+	// when the time leaves the segment
+	vec3 sample(float time, unsigned int& cursor, DecodedSegment& segment, vec3& from, vec3& to) const;
+};
+
+// Linearly interpolated track of rotations with the smallest three encoding (48 bits per key), or as floats if it is not precise enough
+struct CompressedQuatTrack
+{
+	std::vector<float> times;
+	std::vector<uint16_t> values;	// 3 per key (see encode_rotation)
+	std::vector<quat> full_values;	// instead of values, if not quantized
+	Interpolation interpolation = Interpolation::Linear; // linear or constant
+
+	unsigned int size() const;
+	size_t get_bytes() const;
+	quat get_value(unsigned int key) const;
+	quat sample(float time, unsigned int& cursor, DecodedSegment& segment, quat& from, quat& to) const;
+};
+
+struct CompressedTransformTrack
+{
+	unsigned int joint_id = 0;
+	CompressedVec3Track position;
+	CompressedQuatTrack rotation;
+	CompressedVec3Track scale;
+
+	// cursors and segments hold 3 values, from and to the decoded keys of the current segments
+	Transform sample(const Transform& reference, float time, unsigned int* cursors, DecodedSegment* segments, Transform& from, Transform& to) const;
+};
+
+// Clip with the redundant keys removed and the rest quantized (see compress_clip). It is sampled like a Clip
+class CompressedClip
+{
+protected:
+	std::string name;
+	std::vector<CompressedTransformTrack> tracks;
+	float start_time = 0.0f;
+	float end_time = 0.0f;
+	bool looping = true;
+
+	// unique for each set of tracks (copies share it, as they have the same keys), to tell the clip of a ClipCursor
+	static std::atomic<uint64_t> last_id;
+	uint64_t id = ++last_id;
+
+public:
+	CompressedClip(); // Empty clip
+	CompressedClip(const std::string& name, std::vector<CompressedTransformTrack>&& tracks, float start_time, float end_time, bool looping);
+
+	const std::string& get_name() const;
+	unsigned int size() const;
+	const CompressedTransformTrack& get_track(unsigned int index) const;
+	// Memory used by the keys
+	size_t get_bytes() const;
+
+	float get_start_time() const;
+	float get_end_time() const;
+	float get_duration() const;
+	bool get_looping() const;
+	void set_looping(bool looping);
+
+	float adjust_time(float time) const;
+	// Set the local transform of the animated joints of the pose at the given playback time. Returns the time of the clip
+	float sample(Pose& pose, float time, ClipCursor& cursor) const;
+	float sample(Pose& pose, float time) const;
+};
+
+struct ClipCompressionSettings
+{
+	// largest distance allowed between a joint in world space (and the points around it) in the original and in the compressed clip
+	float tolerance = 0.001f;
+	// distance to the joint of the points also measured, as the skinned vertices around it also move when it rotates
+	float shell_distance = 0.03f;
+	// tolerance of each joint, to be more precise on some of them (empty to use the same tolerance for all of them)
+	std::vector<float> joint_tolerances;
+};
+
+struct ClipCompressionStats
+{
+	size_t original_bytes = 0;
+	size_t compressed_bytes = 0;
+	float ratio = 1.0f;				// original / compressed
+	unsigned int original_keys = 0;
+	unsigned int compressed_keys = 0;
+	float max_error = 0.0f;			// largest world distance error measured at the keys of the original clip and between the resampled keys
+	int max_error_joint = -1;
+	unsigned int num_failed_joints = 0;	// joints over their tolerance (0 unless a cubic clip needs more resampling than allowed)
+};
+
+// Compress a clip of the skeleton of the rest pose: the keys that can be interpolated from their neighbours within the tolerance
+// are removed, and the rest are quantized (or kept as floats if the quantization is not precise enough). Cubic tracks are resampled
+// and stored as linear. The error is measured in world space through the hierarchy of the pose, at the keys of the original clip
+// and between the resampled keys. While a joint exceeds its tolerance, the joints of its chain that add the largest errors are
+// compressed again more precisely: with a smaller tolerance, then keeping as floats the keys that are not exactly interpolated,
+// then resampling their cubic tracks more often. The most precise result is returned
+CompressedClip compress_clip(const Clip& clip, Pose& rest_pose, const ClipCompressionSettings& settings = ClipCompressionSettings(), ClipCompressionStats* stats = nullptr);
\ No newline at end of file
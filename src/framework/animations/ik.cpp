@@ -0,0 +1,278 @@
+#include "ik.h"
+#include "../frame_arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#define IK_EPSILON 1e-8f
+
+// Rotation that turns the direction from into the direction to (none if any of them is too short)
+static quat rotation_between(const vec3& from, const vec3& to)
+{
+	if (len_sq(from) < IK_EPSILON || len_sq(to) < IK_EPSILON) {
+		return quat();
+	}
+	return from_to(from, to);
+}
+
+IKChain::IKChain() { }
+
+IKChain::IKChain(Pose& pose, unsigned int root_id, unsigned int end_id)
+{
+	set_joints(pose, root_id, end_id);
+}
+
+void IKChain::set_joints(Pose& pose, unsigned int root_id, unsigned int end_id)
+{
+	joints.clear();
+	int id = (int)end_id;
+	while (id >= 0 && id != (int)root_id) {
+		joints.push_back((unsigned int)id);
+		id = pose.get_parent(id);
+	}
+	if (id < 0) {
+		std::cout << "[Warning] IKChain::set_joints: the joint " << root_id << " is not an ancestor of " << end_id << std::endl;
+		joints.clear();
+		return;
+	}
+	joints.push_back(root_id);
+	std::reverse(joints.begin(), joints.end());
+	load(pose);
+}
+
+unsigned int IKChain::size() const
+{
+	return (unsigned int)joints.size();
+}
+
+unsigned int IKChain::get_joint(unsigned int index) const
+{
+	return joints[index];
+}
+
+const Transform& IKChain::get_global_transform(unsigned int index) const
+{
+	return globals[index];
+}
+
+const vec3& IKChain::get_end_position() const
+{
+	return globals.back().position;
+}
+
+void IKChain::load(Pose& pose)
+{
+	// the pose evaluates all its global transforms in one pass, then they are only read
+	globals.resize(joints.size());
+	for (unsigned int i = 0; i < joints.size(); i++) {
+		globals[i] = pose.get_global_transform(joints[i]);
+	}
+	int parent_id = joints.empty() ? -1 : pose.get_parent(joints[0]);
+	parent_rotation = parent_id >= 0 ? pose.get_global_transform(parent_id).rotation : quat();
+}
+
+void IKChain::store(Pose& pose) const
+{
+	// global rotation = local rotation * parent rotation
+	for (unsigned int i = 0; i < joints.size(); i++) {
+		const quat& parent = i == 0 ? parent_rotation : globals[i - 1].rotation;
+		Transform local = pose.get_local_transform(joints[i]);
+		local.rotation = normalized(globals[i].rotation * inverse(parent));
+		pose.set_local_transform(joints[i], local);
+	}
+}
+
+void IKChain::rotate(unsigned int index, const quat& rotation)
+{
+	const vec3 pivot = globals[index].position;
+	globals[index].rotation = normalized(globals[index].rotation * rotation);
+	for (unsigned int i = index + 1; i < globals.size(); i++) {
+		globals[i].position = pivot + rotation * (globals[i].position - pivot);
+		globals[i].rotation = normalized(globals[i].rotation * rotation);
+	}
+}
+
+bool IKChain::solve_ccd(const vec3& target, unsigned int iterations, float threshold)
+{
+	if (joints.size() < 2) {
+		return false;
+	}
+	float threshold_sq = threshold * threshold;
+	unsigned int last = (unsigned int)joints.size() - 1;
+	for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+		if (len_sq(target - globals[last].position) < threshold_sq) {
+			return true;
+		}
+		for (int i = (int)last - 1; i >= 0; i--) {
+			const vec3& position = globals[i].position;
+			rotate(i, rotation_between(globals[last].position - position, target - position));
+		}
+	}
+	return len_sq(target - globals[last].position) < threshold_sq;
+}
+
+bool IKChain::solve_fabrik(const vec3& target, unsigned int iterations, float threshold)
+{
+	if (joints.size() < 2) {
+		return false;
+	}
+	unsigned int count = (unsigned int)joints.size();
+	float threshold_sq = threshold * threshold;
+
+	// temporaries of the solve, from the frame arena (solves run every frame, in parallel jobs)
+	frame_vector<vec3> positions(count);
+	frame_vector<float> lengths(count - 1);
+	float total_length = 0.0f;
+	for (unsigned int i = 0; i < count; i++) {
+		positions[i] = globals[i].position;
+		if (i > 0) {
+			lengths[i - 1] = len(positions[i] - positions[i - 1]);
+			total_length += lengths[i - 1];
+		}
+	}
+
+	const vec3 base = positions[0];
+	if (len_sq(target - base) >= total_length * total_length) {
+		// out of reach: stretch the chain towards the target
+		vec3 direction = normalized(target - base);
+		for (unsigned int i = 1; i < count; i++) {
+			positions[i] = positions[i - 1] + direction * lengths[i - 1];
+		}
+	}
+	else {
+		for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+			if (len_sq(target - positions[count - 1]) < threshold_sq) {
+				break;
+			}
+			// backward: the end effector to the target, every joint towards its child at the length of its bone
+			positions[count - 1] = target;
+			for (int i = (int)count - 2; i >= 0; i--) {
+				vec3 direction = positions[i] - positions[i + 1];
+				if (len_sq(direction) > IK_EPSILON) {
+					positions[i] = positions[i + 1] + normalized(direction) * lengths[i];
+				}
+			}
+			// forward: the root back to its place, every joint towards its parent at the length of its bone
+			positions[0] = base;
+			for (unsigned int i = 1; i < count; i++) {
+				vec3 direction = positions[i] - positions[i - 1];
+				if (len_sq(direction) > IK_EPSILON) {
+					positions[i] = positions[i - 1] + normalized(direction) * lengths[i - 1];
+				}
+			}
+		}
+	}
+
+	// rotate every bone to its new direction, the rotations of the parents have already moved it to its new start
+	for (unsigned int i = 0; i + 1 < count; i++) {
+		rotate(i, rotation_between(globals[i + 1].position - globals[i].position, positions[i + 1] - globals[i].position));
+	}
+	return len_sq(target - globals[count - 1].position) < threshold_sq;
+}
+
+bool IKChain::solve_two_bone(const vec3& target)
+{
+	if (joints.size() != 3) {
+		std::cout << "[Warning] IKChain::solve_two_bone: the chain has " << joints.size() << " joints instead of 3" << std::endl;
+		return false;
+	}
+
+	const vec3 a = globals[0].position;
+	const vec3 b = globals[1].position;
+	const vec3 c = globals[2].position;
+	float length_ab = len(b - a);
+	float length_bc = len(c - b);
+	float length_at = len(target - a);
+	bool reachable = length_at <= length_ab + length_bc && length_at >= fabsf(length_ab - length_bc);
+	// keep the triangle valid (a straight or a folded chain has no bending plane)
+	length_at = std::clamp(length_at, fabsf(length_ab - length_bc) + 1e-4f, length_ab + length_bc - 1e-4f);
+	if (length_ab < 1e-6f || length_bc < 1e-6f) {
+		return false;
+	}
+
+	// bend in the plane of the bones, or any plane if they are aligned
+	vec3 axis = cross(c - a, b - a);
+	if (len_sq(axis) < IK_EPSILON) {
+		axis = cross(c - a, fabsf((c - a).x) < 0.9f * len(c - a) ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f));
+	}
+	normalize(axis);
+
+	// angles at a (between ac and ab) and at b (between ba and bc), now and to reach the target
+	auto angle_between = [](const vec3& u, const vec3& v) {
+		float lengths = len(u) * len(v);
+		return lengths > 0.0f ? acosf(std::clamp(dot(u, v) / lengths, -1.0f, 1.0f)) : 0.0f;
+	};
+	float angle_a = angle_between(c - a, b - a);
+	float angle_b = angle_between(a - b, c - b);
+	float new_angle_a = acosf(std::clamp((length_ab * length_ab + length_at * length_at - length_bc * length_bc) / (2.0f * length_ab * length_at), -1.0f, 1.0f));
+	float new_angle_b = acosf(std::clamp((length_ab * length_ab + length_bc * length_bc - length_at * length_at) / (2.0f * length_ab * length_bc), -1.0f, 1.0f));
+
+	// rotating around the axis opens the angles (it turns ab away from ac, and bc away from ba)
+	rotate(1, angle_axis(new_angle_b - angle_b, axis));
+	rotate(0, angle_axis(new_angle_a - angle_a, axis));
+	// the end effector is at the distance of the target: turn the chain to it
+	rotate(0, rotation_between(globals[2].position - a, target - a));
+	return reachable;
+}
+
+bool IKChain::solve_two_bone(const vec3& target, const vec3& pole)
+{
+	bool reachable = solve_two_bone(target);
+	if (joints.size() != 3) {
+		return false;
+	}
+
+	// swing the chain around the line to the end effector, so the middle joint points to the pole
+	const vec3 a = globals[0].position;
+	vec3 line = globals[2].position - a;
+	if (len_sq(line) < IK_EPSILON) {
+		return reachable;
+	}
+	normalize(line);
+	vec3 to_middle = reject(globals[1].position - a, line);
+	vec3 to_pole = reject(pole - a, line);
+	if (len_sq(to_middle) > IK_EPSILON && len_sq(to_pole) > IK_EPSILON) {
+		float angle = atan2f(dot(cross(to_middle, to_pole), line), dot(to_middle, to_pole));
+		rotate(0, angle_axis(angle, line));
+	}
+	return reachable;
+}
+
+float IKChain::benchmark(IKSolver solver, unsigned int num_joints, unsigned int num_solves)
+{
+	if (solver == IK_TWO_BONE) {
+		num_joints = 3;
+	}
+	num_joints = std::max(num_joints, 2u);
+
+	// straight chain of bones of length 1 along y
+	Pose pose(num_joints);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (i > 0) {
+			pose.set_parent(i, i - 1);
+		}
+		pose.set_local_transform(i, Transform(vec3(0.0f, i > 0 ? 1.0f : 0.0f, 0.0f), quat(), vec3(1.0f, 1.0f, 1.0f)));
+	}
+	const Pose rest = pose;
+	IKChain chain(pose, 0, num_joints - 1);
+
+	float reach = (num_joints - 1) * 0.7f;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int s = 0; s < num_solves; s++) {
+		// targets on a circle in front of the chain
+		float angle = s * 0.1f;
+		vec3 target(cosf(angle) * reach * 0.5f, reach * 0.7f, sinf(angle) * reach * 0.5f);
+		pose = rest;
+		chain.load(pose);
+		switch (solver) {
+		case IK_CCD: chain.solve_ccd(target); break;
+		case IK_FABRIK: chain.solve_fabrik(target); break;
+		case IK_TWO_BONE: chain.solve_two_bone(target, vec3(0.0f, 0.0f, 1.0f)); break;
+		}
+		chain.store(pose);
+	}
+	float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return milliseconds > 0.0f ? num_solves / milliseconds : 0.0f;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include "pose.h"
+
+enum IKSolver { IK_CCD, IK_FABRIK, IK_TWO_BONE };
+
+// Chain of joints of a pose, from a root joint to an end effector, solved in the global space of the pose
+// The global transforms of the chain are read once (load), updated incrementally by every rotation of the solvers (a joint only moves
+// its descendants in the chain, nothing is re-evaluated from the root) and written back to the local rotations of the pose in one step
+// (store). The positions and scales of the joints are kept: the solvers only rotate
+class IKChain
+{
+protected:
+	std::vector<unsigned int> joints;	// ids in the pose, root first
+	std::vector<Transform> globals;		// global transforms of the joints
+	quat parent_rotation;				// global rotation of the parent of the root
+
+public:
+	IKChain(); // Empty chain
+	// Chain from root_id to end_id (root_id must be an ancestor of end_id)
+	IKChain(Pose& pose, unsigned int root_id, unsigned int end_id);
+
+	void set_joints(Pose& pose, unsigned int root_id, unsigned int end_id);
+	unsigned int size() const;
+	unsigned int get_joint(unsigned int index) const;
+	const Transform& get_global_transform(unsigned int index) const;
+	const vec3& get_end_position() const;
+
+	// Read the global transforms of the chain from the pose
+	void load(Pose& pose);
+	// Write the rotations of the chain to the local transforms of the pose
+	void store(Pose& pose) const;
+
+	// Rotate a joint by a rotation in global space (applied after its current rotation), moving its descendants in the chain
+	void rotate(unsigned int index, const quat& rotation);
+
+	// Cyclic coordinate descent: from the end to the root, rotate every joint to point the end effector at the target
+	// Returns true if the end effector is closer than the threshold to the target
+	bool solve_ccd(const vec3& target, unsigned int iterations = 16, float threshold = 0.001f);
+	// Forward and backward reaching: move the joints along the chain to the target and back to the root keeping the lengths of the
+	// bones, then rotate the bones to the new positions. Returns true if the end effector is closer than the threshold to the target
+	bool solve_fabrik(const vec3& target, unsigned int iterations = 16, float threshold = 0.001f);
+	// Analytic solver of a chain of 3 joints (e.g. hip, knee and ankle) with the law of cosines. The middle joint keeps bending in the
+	// plane it bends now, or towards the pole (a world position, e.g. in front of the knee). Returns true if the target is reachable
+	bool solve_two_bone(const vec3& target);
+	bool solve_two_bone(const vec3& target, const vec3& pole);
+
+	// Solves per millisecond of a straight chain of num_joints joints (with load and store) towards targets around it
+	static float benchmark(IKSolver solver, unsigned int num_joints, unsigned int num_solves = 1000);
+};
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include "motion_database.h"
+#include "../job_system.h"
+
+#include <cmath>
+#include <iostream>
+
+#define MOTION_SMALL_BOX_SIZE 16	// frames per small box
+#define MOTION_LARGE_BOX_SIZE 4		// small boxes per large box
+
+static SIMD_INLINE float horizontal_sum(simd_float a)
+{
+	alignas(SIMD_ALIGNMENT) float lanes[SIMD_WIDTH];
+	simd_store(lanes, a);
+	float sum = 0.0f;
+	for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+		sum += lanes[lane];
+	}
+	return sum;
+}
+
+// Squared distance between a query and a row of stride floats (the queries may be unaligned, the rows are aligned)
+static SIMD_INLINE float distance_sq(const float* query, const float* row, unsigned int stride)
+{
+	simd_float sum = simd_set1(0.0f);
+	for (unsigned int k = 0; k < stride; k += SIMD_WIDTH) {
+		simd_float d = simd_sub(simd_loadu(query + k), simd_load(row + k));
+		sum = simd_madd(d, d, sum);
+	}
+	return horizontal_sum(sum);
+}
+
+// Squared distance from a row to the nearest point of a box, a lower bound of the distance to every row inside it
+static SIMD_INLINE float box_distance_sq(const float* query, const float* box_min, const float* box_max, unsigned int stride)
+{
+	simd_float zero = simd_set1(0.0f);
+	simd_float sum = zero;
+	for (unsigned int k = 0; k < stride; k += SIMD_WIDTH) {
+		simd_float q = simd_loadu(query + k);
+		simd_float d = simd_max(simd_max(simd_sub(simd_load(box_min + k), q), simd_sub(q, simd_load(box_max + k))), zero);
+		sum = simd_madd(d, d, sum);
+	}
+	return horizontal_sum(sum);
+}
+
+// Position relative to the character, rotated to its space (x to its right, z to its front)
+static vec3 to_character_space(const vec3& v, const vec3& direction)
+{
+	return vec3(v.x * direction.z - v.z * direction.x, v.y, v.x * direction.x + v.z * direction.z);
+}
+
+MotionDatabase::MotionDatabase(const MotionDatabaseSettings& settings)
+{
+	this->settings = settings;
+	num_features = (unsigned int)(settings.feature_joints.size() * 6 + settings.trajectory_times.size() * 4);
+	stride = simd_padded_size(num_features);
+}
+
+unsigned int MotionDatabase::add_clip_info(const std::string& name, float start_time, float end_time, bool looping)
+{
+	MotionDatabaseClip clip;
+	clip.name = name;
+	clip.first_frame = get_num_frames();
+	clip.start_time = start_time;
+	clip.duration = std::max(end_time - start_time, 0.0f);
+	clip.looping = looping;
+	// same frames as BakedPalettes: a looping clip wraps from its last frame to the first one, the others end at their end
+	float frames = clip.duration * settings.frame_rate;
+	clip.num_frames = looping ? std::max(1u, (unsigned int)ceilf(frames)) : (unsigned int)ceilf(frames) + 1;
+
+	// the frames of a clip that does not loop are only matched while the whole trajectory is inside the clip
+	float horizon = settings.trajectory_times.empty() ? 0.0f : settings.trajectory_times.back();
+	if (looping) {
+		clip.num_searchable = clip.num_frames;
+	}
+	else {
+		int searchable = (int)floorf((clip.duration - horizon) * settings.frame_rate) + 1;
+		clip.num_searchable = (unsigned int)std::clamp(searchable, 1, (int)clip.num_frames);
+	}
+
+	clips.push_back(clip);
+	return (unsigned int)clips.size() - 1;
+}
+
+void MotionDatabase::get_character_frame(Pose& pose, vec3& position, vec3& direction) const
+{
+	Transform root = pose.get_global_transform(settings.root_id);
+	position = vec3(root.position.x, 0.0f, root.position.z);
+	direction = root.rotation * settings.forward;
+	direction.y = 0.0f;
+	if (len_sq(direction) < 1e-8f) {
+		// facing up or down: any direction on the ground is as good
+		direction = vec3(0.0f, 0.0f, 1.0f);
+	}
+	normalize(direction);
+}
+
+void MotionDatabase::compute_features(Pose& pose, Pose& previous_pose, float dt, const std::vector<vec3>& trajectory_positions,
+	const std::vector<vec3>& trajectory_directions, float* out) const
+{
+	vec3 position, direction;
+	get_character_frame(pose, position, direction);
+
+	unsigned int num_joints = (unsigned int)settings.feature_joints.size();
+	const std::vector<mat4>& globals = pose.get_global_matrices();
+	const std::vector<mat4>& previous_globals = previous_pose.get_global_matrices();
+	float* positions = out;
+	float* velocities = out + num_joints * 3;
+	for (unsigned int i = 0; i < num_joints; i++) {
+		unsigned int joint_id = settings.feature_joints[i];
+		vec3 joint_position, velocity;
+		if (joint_id < globals.size() && joint_id < previous_globals.size()) {
+			const mat4& m = globals[joint_id];
+			const mat4& p = previous_globals[joint_id];
+			joint_position = to_character_space(vec3(m.data[12], m.data[13], m.data[14]) - position, direction);
+			velocity = to_character_space(vec3(m.data[12] - p.data[12], m.data[13] - p.data[13], m.data[14] - p.data[14]) / dt, direction);
+		}
+		positions[i * 3 + 0] = joint_position.x;
+		positions[i * 3 + 1] = joint_position.y;
+		positions[i * 3 + 2] = joint_position.z;
+		velocities[i * 3 + 0] = velocity.x;
+		velocities[i * 3 + 1] = velocity.y;
+		velocities[i * 3 + 2] = velocity.z;
+	}
+
+	// the trajectory is on the ground: only x and z
+	unsigned int num_samples = (unsigned int)settings.trajectory_times.size();
+	float* future_positions = velocities + num_joints * 3;
+	float* future_directions = future_positions + num_samples * 2;
+	for (unsigned int k = 0; k < num_samples; k++) {
+		vec3 future_position, future_direction;
+		if (k < trajectory_positions.size() && k < trajectory_directions.size()) {
+			future_position = to_character_space(trajectory_positions[k] - position, direction);
+			future_direction = to_character_space(trajectory_directions[k], direction);
+		}
+		future_positions[k * 2 + 0] = future_position.x;
+		future_positions[k * 2 + 1] = future_position.z;
+		future_directions[k * 2 + 0] = future_direction.x;
+		future_directions[k * 2 + 1] = future_direction.z;
+	}
+}
+
+void MotionDatabase::build()
+{
+	unsigned int num_frames = get_num_frames();
+	offsets.assign(num_features, 0.0f);
+	scales.assign(num_features, 1.0f);
+	features.assign((size_t)num_frames * stride, 0.0f);
+	dirty = false;
+	if (num_frames == 0) {
+		build_boxes();
+		return;
+	}
+
+	// the offset of every feature is its mean, and its scale the weight of its part over the deviation of the part (the mean of the
+	// deviations of its features, so a part keeps the proportions between its features, e.g. a long stride is still long)
+	for (unsigned int f = 0; f < num_frames; f++) {
+		for (unsigned int i = 0; i < num_features; i++) {
+			offsets[i] += raw_features[(size_t)f * num_features + i];
+		}
+	}
+	for (unsigned int i = 0; i < num_features; i++) {
+		offsets[i] /= num_frames;
+	}
+
+	unsigned int num_joints = (unsigned int)settings.feature_joints.size();
+	unsigned int num_samples = (unsigned int)settings.trajectory_times.size();
+	unsigned int part_sizes[4] = { num_joints * 3, num_joints * 3, num_samples * 2, num_samples * 2 };
+	float part_weights[4] = { settings.position_weight, settings.velocity_weight, settings.trajectory_position_weight, settings.trajectory_direction_weight };
+	unsigned int begin = 0;
+	for (unsigned int part = 0; part < 4; part++) {
+		unsigned int end = begin + part_sizes[part];
+		if (end == begin) {
+			continue;
+		}
+		double variance = 0.0;
+		for (unsigned int f = 0; f < num_frames; f++) {
+			for (unsigned int i = begin; i < end; i++) {
+				double d = raw_features[(size_t)f * num_features + i] - offsets[i];
+				variance += d * d;
+			}
+		}
+		float deviation = (float)sqrt(variance / ((double)num_frames * (end - begin)));
+		float scale = deviation > 1e-6f ? part_weights[part] / deviation : part_weights[part];
+		for (unsigned int i = begin; i < end; i++) {
+			scales[i] = scale;
+		}
+		begin = end;
+	}
+
+	for (unsigned int f = 0; f < num_frames; f++) {
+		const float* raw = &raw_features[(size_t)f * num_features];
+		float* row = &features[(size_t)f * stride];
+		for (unsigned int i = 0; i < num_features; i++) {
+			row[i] = (raw[i] - offsets[i]) * scales[i];
+		}
+	}
+
+	build_boxes();
+}
+
+void MotionDatabase::build_boxes()
+{
+	small_boxes.clear();
+	large_boxes.clear();
+
+	// boxes never span two clips, so the frames that cannot be matched are left out
+	for (const MotionDatabaseClip& clip : clips) {
+		unsigned int first_box = (unsigned int)small_boxes.size();
+		for (unsigned int f = 0; f < clip.num_searchable; f += MOTION_SMALL_BOX_SIZE) {
+			small_boxes.push_back({ clip.first_frame + f, std::min((unsigned int)MOTION_SMALL_BOX_SIZE, clip.num_searchable - f) });
+		}
+		unsigned int num_boxes = (unsigned int)small_boxes.size() - first_box;
+		for (unsigned int b = 0; b < num_boxes; b += MOTION_LARGE_BOX_SIZE) {
+			large_boxes.push_back({ first_box + b, std::min((unsigned int)MOTION_LARGE_BOX_SIZE, num_boxes - b) });
+		}
+	}
+
+	small_bounds_min.assign(small_boxes.size() * stride, FLT_MAX);
+	small_bounds_max.assign(small_boxes.size() * stride, -FLT_MAX);
+	for (unsigned int b = 0; b < small_boxes.size(); b++) {
+		float* box_min = &small_bounds_min[(size_t)b * stride];
+		float* box_max = &small_bounds_max[(size_t)b * stride];
+		for (unsigned int f = small_boxes[b].first; f < small_boxes[b].first + small_boxes[b].count; f++) {
+			const float* row = &features[(size_t)f * stride];
+			for (unsigned int i = 0; i < stride; i++) {
+				box_min[i] = std::min(box_min[i], row[i]);
+				box_max[i] = std::max(box_max[i], row[i]);
+			}
+		}
+	}
+
+	large_bounds_min.assign(large_boxes.size() * stride, FLT_MAX);
+	large_bounds_max.assign(large_boxes.size() * stride, -FLT_MAX);
+	for (unsigned int b = 0; b < large_boxes.size(); b++) {
+		float* box_min = &large_bounds_min[(size_t)b * stride];
+		float* box_max = &large_bounds_max[(size_t)b * stride];
+		for (unsigned int s = large_boxes[b].first; s < large_boxes[b].first + large_boxes[b].count; s++) {
+			for (unsigned int i = 0; i < stride; i++) {
+				box_min[i] = std::min(box_min[i], small_bounds_min[(size_t)s * stride + i]);
+				box_max[i] = std::max(box_max[i], small_bounds_max[(size_t)s * stride + i]);
+			}
+		}
+	}
+}
+
+unsigned int MotionDatabase::get_num_features() const
+{
+	return num_features;
+}
+
+unsigned int MotionDatabase::get_stride() const
+{
+	return stride;
+}
+
+unsigned int MotionDatabase::get_num_frames() const
+{
+	return clips.empty() ? 0 : clips.back().first_frame + clips.back().num_frames;
+}
+
+unsigned int MotionDatabase::get_num_clips() const
+{
+	return (unsigned int)clips.size();
+}
+
+const MotionDatabaseClip& MotionDatabase::get_clip(unsigned int clip_id) const
+{
+	return clips[clip_id];
+}
+
+const MotionDatabaseSettings& MotionDatabase::get_settings() const
+{
+	return settings;
+}
+
+const float* MotionDatabase::get_features(unsigned int frame) const
+{
+	return &features[(size_t)frame * stride];
+}
+
+float MotionDatabase::get_frame_time(unsigned int clip_id, unsigned int frame) const
+{
+	const MotionDatabaseClip& clip = clips[clip_id];
+	return clip.start_time + frame / settings.frame_rate;
+}
+
+void MotionDatabase::get_frame(unsigned int frame, unsigned int& clip_id, float& time) const
+{
+	// the clips are sorted by their first frame
+	auto it = std::upper_bound(clips.begin(), clips.end(), frame, [](unsigned int frame, const MotionDatabaseClip& clip) {
+		return frame < clip.first_frame;
+	});
+	clip_id = (unsigned int)(it - clips.begin()) - 1;
+	time = get_frame_time(clip_id, frame - clips[clip_id].first_frame);
+}
+
+void MotionDatabase::compute_query(Pose& pose, Pose& previous_pose, float dt, const std::vector<vec3>& trajectory_positions,
+	const std::vector<vec3>& trajectory_directions, float* query) const
+{
+	// the raw features go first in the query, then they are normalized in place
+	compute_features(pose, previous_pose, dt, trajectory_positions, trajectory_directions, query);
+	for (unsigned int i = 0; i < num_features; i++) {
+		query[i] = (query[i] - offsets[i]) * scales[i];
+	}
+	for (unsigned int i = num_features; i < stride; i++) {
+		query[i] = 0.0f;
+	}
+}
+
+MotionMatch MotionDatabase::search(const float* query, unsigned int max_evaluations, int current_frame) const
+{
+	MotionMatch match;
+	if (dirty) {
+		std::cout << "[Warning] MotionDatabase::search: the database has new clips, call build before searching" << std::endl;
+		return match;
+	}
+
+	const float* q = query;
+	unsigned int budget = max_evaluations ? max_evaluations : ~0u;
+
+	if (current_frame >= 0 && current_frame < (int)get_num_frames()) {
+		match.frame = current_frame;
+		match.cost = distance_sq(q, get_features(current_frame), stride);
+		match.evaluated = 1;
+	}
+
+	for (unsigned int l = 0; l < large_boxes.size(); l++) {
+		if (box_distance_sq(q, &large_bounds_min[(size_t)l * stride], &large_bounds_max[(size_t)l * stride], stride) >= match.cost) {
+			continue;
+		}
+		const Box& large_box = large_boxes[l];
+		for (unsigned int s = large_box.first; s < large_box.first + large_box.count; s++) {
+			if (box_distance_sq(q, &small_bounds_min[(size_t)s * stride], &small_bounds_max[(size_t)s * stride], stride) >= match.cost) {
+				continue;
+			}
+			const Box& small_box = small_boxes[s];
+			for (unsigned int f = small_box.first; f < small_box.first + small_box.count; f++) {
+				if (match.evaluated >= budget) {
+					return match;
+				}
+				float cost = distance_sq(q, get_features(f), stride);
+				match.evaluated++;
+				if (cost < match.cost) {
+					match.frame = (int)f;
+					match.cost = cost;
+				}
+			}
+		}
+	}
+	return match;
+}
+
+void MotionDatabase::search(const float* queries, unsigned int num_queries, MotionMatch* matches, unsigned int max_evaluations,
+	const int* current_frames) const
+{
+	// a search is a few microseconds: ranges of a few queries per job
+	parallel_for(num_queries, [&](unsigned int i) {
+		matches[i] = search(queries + (size_t)i * stride, max_evaluations, current_frames ? current_frames[i] : -1);
+	}, 8);
+}
\ No newline at end of file
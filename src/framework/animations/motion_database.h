@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <string>
+#include <vector>
+#include "skeleton.h"
+#include "../math/simd.h"
+
+// What the motion database describes every frame with, and how much each part counts in the search
+struct MotionDatabaseSettings
+{
+	std::vector<unsigned int> feature_joints;						// joints whose position and velocity are matched (e.g. the feet and the hips)
+	std::vector<float> trajectory_times = { 0.33f, 0.67f, 1.0f };	// seconds ahead of the future positions and directions of the root
+	unsigned int root_id = 0;
+	vec3 forward = vec3(0.0f, 0.0f, 1.0f);							// facing direction of the root in its local space
+	float frame_rate = 30.0f;
+
+	float position_weight = 1.0f;
+	float velocity_weight = 1.0f;
+	float trajectory_position_weight = 1.0f;
+	float trajectory_direction_weight = 1.5f;
+};
+
+// Clip of a MotionDatabase: its frames are first_frame to first_frame + num_frames - 1, and the first num_searchable ones can be
+// matched (the last frames of a clip that does not loop have no future trajectory)
+struct MotionDatabaseClip
+{
+	std::string name;
+	unsigned int first_frame = 0;
+	unsigned int num_frames = 0;
+	unsigned int num_searchable = 0;
+	float start_time = 0.0f;
+	float duration = 0.0f;
+	bool looping = true;
+};
+
+// Result of a search: the frame with the lowest cost among the evaluated ones
+struct MotionMatch
+{
+	int frame = -1;
+	float cost = FLT_MAX;			// squared distance between the normalized features
+	unsigned int evaluated = 0;		// frames whose distance was computed
+};
+
+// Frames of some clips described by feature vectors (positions and velocities of some joints and the future trajectory of the root,
+// all in the space of the character: its root projected on the ground, facing its forward direction) to find the frame that best
+// matches the current state of a character (motion matching). The features are normalized, so every part weighs the same no matter
+// its units, and stored in a contiguous matrix with SIMD aligned rows. The search skips whole groups of frames by the distance to
+// their bounding boxes, and can stop after evaluating a budget of frames with the best match found so far
+class MotionDatabase
+{
+protected:
+	struct Box
+	{
+		unsigned int first = 0;	// first frame (small boxes) or first small box (large boxes)
+		unsigned int count = 0;
+	};
+
+	MotionDatabaseSettings settings;
+	unsigned int num_features = 0;
+	unsigned int stride = 0;		// floats per row, num_features padded to the SIMD width
+
+	std::vector<MotionDatabaseClip> clips;
+	std::vector<float> raw_features;	// num_features per frame, as computed
+	aligned_vector<float> features;		// stride per frame, normalized
+	std::vector<float> offsets;			// normalized = (raw - offset) * scale
+	std::vector<float> scales;
+
+	// bounds of the normalized features of groups of frames (small boxes) and of groups of small boxes (large boxes), stride per box
+	std::vector<Box> small_boxes;
+	std::vector<Box> large_boxes;
+	aligned_vector<float> small_bounds_min;
+	aligned_vector<float> small_bounds_max;
+	aligned_vector<float> large_bounds_min;
+	aligned_vector<float> large_bounds_max;
+
+	bool dirty = false; // frames added since the last build
+
+	unsigned int add_clip_info(const std::string& name, float start_time, float end_time, bool looping);
+	// Position on the ground and facing direction (unit, on the ground) of the character in the pose
+	void get_character_frame(Pose& pose, vec3& position, vec3& direction) const;
+	// Features of a pose (whose velocities come from the pose dt seconds before) and its trajectory, in world space
+	void compute_features(Pose& pose, Pose& previous_pose, float dt, const std::vector<vec3>& trajectory_positions,
+		const std::vector<vec3>& trajectory_directions, float* out) const;
+	void build_boxes();
+
+public:
+	MotionDatabase(const MotionDatabaseSettings& settings = MotionDatabaseSettings());
+
+	// Add the frames of the clip played by the skeleton at the frame rate of the settings and return its id. Works with any clip type
+	// with get_name, get_start_time, get_end_time, get_looping and sample(Pose&, time) (Clip, CompressedClip or BakedClip)
+	// The future trajectory of a looping clip wraps to its start, so looping clips should play in place
+	template <typename ClipType>
+	unsigned int add_clip(const ClipType& clip, Skeleton& skeleton)
+	{
+		unsigned int id = add_clip_info(clip.get_name(), clip.get_start_time(), clip.get_end_time(), clip.get_looping());
+		const MotionDatabaseClip& info = clips[id];
+		float frame_time = 1.0f / settings.frame_rate;
+
+		Pose pose = skeleton.get_rest_pose();
+		Pose previous_pose = pose;
+		Pose future_pose = pose;
+		std::vector<vec3> trajectory_positions(settings.trajectory_times.size());
+		std::vector<vec3> trajectory_directions(settings.trajectory_times.size());
+		raw_features.resize((size_t)(info.first_frame + info.num_frames) * num_features);
+		for (unsigned int f = 0; f < info.num_frames; f++) {
+			float time = get_frame_time(id, f);
+			clip.sample(pose, time);
+			clip.sample(previous_pose, info.looping ? time - frame_time : std::max(time - frame_time, info.start_time));
+			for (unsigned int k = 0; k < settings.trajectory_times.size(); k++) {
+				clip.sample(future_pose, time + settings.trajectory_times[k]);
+				get_character_frame(future_pose, trajectory_positions[k], trajectory_directions[k]);
+			}
+			compute_features(pose, previous_pose, frame_time, trajectory_positions, trajectory_directions,
+				&raw_features[(size_t)(info.first_frame + f) * num_features]);
+		}
+		dirty = true;
+		return id;
+	}
+
+	// Normalize the features and build the search structure (call it after adding the clips)
+	void build();
+
+	unsigned int get_num_features() const;
+	// Floats per row of the normalized features (and of the queries)
+	unsigned int get_stride() const;
+	unsigned int get_num_frames() const;
+	unsigned int get_num_clips() const;
+	const MotionDatabaseClip& get_clip(unsigned int clip_id) const;
+	const MotionDatabaseSettings& get_settings() const;
+	// Normalized features of a frame (stride floats)
+	const float* get_features(unsigned int frame) const;
+
+	// Time of the clip of a frame of the clip (from 0 to num_frames - 1)
+	float get_frame_time(unsigned int clip_id, unsigned int frame) const;
+	// Clip and time of a frame of the database
+	void get_frame(unsigned int frame, unsigned int& clip_id, float& time) const;
+
+	// Normalized query (stride floats) of a character in the pose, moving from the pose dt seconds before, that wants to follow the
+	// trajectory (world positions and directions at the times of the settings)
+	void compute_query(Pose& pose, Pose& previous_pose, float dt, const std::vector<vec3>& trajectory_positions,
+		const std::vector<vec3>& trajectory_directions, float* query) const;
+
+	// Best match for the normalized query. max_evaluations limits the frames whose distance is computed (0 for no limit) and
+	// current_frame (if any) is evaluated first, so the search starts from a good match when the budget runs out
+	MotionMatch search(const float* query, unsigned int max_evaluations = 0, int current_frame = -1) const;
+	// Search the queries (stride floats each) in parallel with the job system. current_frames is optional (one per query)
+	void search(const float* queries, unsigned int num_queries, MotionMatch* matches, unsigned int max_evaluations = 0,
+		const int* current_frames = nullptr) const;
+};
\ No newline at end of file
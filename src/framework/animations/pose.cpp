@@ -1,22 +1,52 @@
 #include "pose.h"
 
-Pose::Pose() { }
+#include <iostream>
+#include <mutex>
 
-Pose::Pose(unsigned int num_joints)
+std::atomic<unsigned int> Pose::num_evaluated_joints = 0;
+std::atomic<uint64_t> Pose::last_version = 0;
+
+// the caches of a pose shared by entities updated in parallel (e.g. the rest pose of a skeleton) are updated by the first thread
+// that queries them, under the lock of the pose (the poses share a few locks, as they are seldom contended)
+static std::mutex& get_cache_mutex(const Pose* pose)
 {
-	resize(num_joints);
+	static std::mutex mutexes[64];
+	return mutexes[(reinterpret_cast<uintptr_t>(pose) / sizeof(void*)) % 64];
+}
+
+static bool load_flag(bool& flag)
+{
+	return std::atomic_ref<bool>(flag).load(std::memory_order_acquire);
+}
+
+static void store_flag(bool& flag, bool value)
+{
+	std::atomic_ref<bool>(flag).store(value, std::memory_order_release);
 }
 
-Pose::Pose(const Pose& p)
+// shared by all the poses without joints
+static const std::shared_ptr<const Rig>& get_empty_rig()
 {
-	*this = p;
+	static const std::shared_ptr<const Rig> empty_rig = std::make_shared<const Rig>();
+	return empty_rig;
 }
 
-// resize arrays
+Pose::Pose() : rig(get_empty_rig()) { }
+
+Pose::Pose(unsigned int num_joints) : rig(get_empty_rig())
+{
+	resize(num_joints);
+}
+
+// resize arrays (the new joints are roots until their parent is set)
 void Pose::resize(unsigned int size)
 {
-	parents.resize(size);
+	edit_parents().resize(size, -1);
 	joints.resize(size);
+	global_joints.resize(size);
+	global_matrices.resize(size);
+	dirty.resize(size);
+	update_version();
 }
 
 // get the number of joints
@@ -28,19 +58,185 @@ unsigned int Pose::size()
 // set parent id
 void Pose::set_parent(unsigned int id, unsigned int parent_id)
 {
-	parents[id] = parent_id;
+	edit_parents()[id] = (int)parent_id;
+	update_version();
 }
 
 // get parent id
 int Pose::get_parent(unsigned int id)
 {
-	return parents[id];
+	return rig_dirty ? edited_parents[id] : rig->get_parent(id);
+}
+
+const std::vector<int>& Pose::get_parents()
+{
+	update_rig();
+	return rig->get_parents();
+}
+
+const std::shared_ptr<const Rig>& Pose::get_rig()
+{
+	update_rig();
+	return rig;
+}
+
+void Pose::set_rig(const std::shared_ptr<const Rig>& rig)
+{
+	if (!rig || rig->size() != size()) {
+		std::cout << "[Warning] The rig does not have the same number of joints as the pose" << std::endl;
+		return;
+	}
+	this->rig = rig;
+	rig_dirty = false;
+	set_all_dirty();
+	update_version();
+}
+
+// the rig is never modified: the parents are copied to edit them, and a new rig is built with them when needed
+std::vector<int>& Pose::edit_parents()
+{
+	if (!rig_dirty) {
+		edited_parents = rig->get_parents();
+		rig_dirty = true;
+	}
+	return edited_parents;
+}
+
+// build the rig with the edited parents (only when the hierarchy has changed), keeping the names of the joints
+void Pose::update_rig()
+{
+	if (!load_flag(rig_dirty)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(get_cache_mutex(this));
+	if (!rig_dirty) {
+		return;
+	}
+
+	std::vector<std::string> names = rig->get_names();
+	if (!names.empty()) {
+		names.resize(edited_parents.size());
+	}
+	rig = std::make_shared<const Rig>(edited_parents, names);
+	edited_parents.clear();
+
+	// the hierarchy has changed: every cached global transform is invalid
+	set_all_dirty();
+	store_flag(rig_dirty, false);
+}
+
+void Pose::set_all_dirty()
+{
+	for (unsigned int i = 0; i < dirty.size(); i++) {
+		dirty[i] = 1;
+	}
+	store_flag(any_dirty, true);
+}
+
+// re-evaluate the dirty joints in evaluation order: a joint is also dirty if its parent has just been re-evaluated
+void Pose::update_global_cache()
+{
+	update_rig();
+	if (!load_flag(any_dirty)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(get_cache_mutex(this));
+	if (!any_dirty) {
+		return;
+	}
+
+	const std::vector<unsigned int>& order = rig->get_evaluation_order();
+	const std::vector<int>& parents = rig->get_parents();
+	unsigned int num_joints = size();
+	unsigned int num_evaluated = 0;
+	for (unsigned int k = 0; k < num_joints; k++) {
+		unsigned int i = order[k];
+		int parent_id = parents[i];
+		bool has_parent = parent_id >= 0 && parent_id < (int)num_joints;
+		if (has_parent && dirty[parent_id]) {
+			dirty[i] = 1;
+		}
+		if (!dirty[i]) {
+			continue;
+		}
+
+		global_joints[i] = has_parent ? combine(global_joints[parent_id], joints[i]) : joints[i];
+		global_matrices[i] = transform_to_mat4(global_joints[i]);
+		num_evaluated++;
+	}
+	num_evaluated_joints += num_evaluated;
+
+	for (unsigned int i = 0; i < num_joints; i++) {
+		dirty[i] = 0;
+	}
+	store_flag(any_dirty, false);
+}
+
+void Pose::update_version()
+{
+	version = ++last_version;
+	version_dirty = false;
+}
+
+uint64_t Pose::get_version() const
+{
+	if (load_flag(version_dirty)) {
+		std::lock_guard<std::mutex> lock(get_cache_mutex(this));
+		if (version_dirty) {
+			version = ++last_version;
+			store_flag(version_dirty, false);
+		}
+	}
+	return version;
+}
+
+bool Pose::is_topologically_sorted()
+{
+	update_rig();
+	return rig->is_topologically_sorted();
+}
+
+const std::vector<unsigned int>& Pose::get_evaluation_order()
+{
+	update_rig();
+	return rig->get_evaluation_order();
+}
+
+// reorder the joints, the parents id and the names given the new id of each joint
+void Pose::remap(const std::vector<unsigned int>& remap)
+{
+	update_rig();
+	const std::vector<int>& parents = rig->get_parents();
+	const std::vector<std::string>& names = rig->get_names();
+	unsigned int num_joints = size();
+	std::vector<Transform> remapped_joints(num_joints);
+	std::vector<int> remapped_parents(num_joints);
+	std::vector<std::string> remapped_names(names.size());
+	for (unsigned int i = 0; i < num_joints; i++) {
+		remapped_joints[remap[i]] = joints[i];
+		remapped_parents[remap[i]] = (parents[i] < 0 || parents[i] >= (int)num_joints) ? -1 : (int)remap[parents[i]];
+		if (!names.empty()) {
+			remapped_names[remap[i]] = names[i];
+		}
+	}
+	joints.swap(remapped_joints);
+	rig = std::make_shared<const Rig>(remapped_parents, remapped_names);
+	set_all_dirty();
+	update_version();
+}
+
+std::vector<unsigned int> Pose::get_topological_remap(const std::vector<int>& parents)
+{
+	return Rig::get_topological_remap(parents);
 }
 
 //set local transform of the joint
 void Pose::set_local_transform(unsigned int id, const Transform& transform)
 {
 	joints[id] = transform;
+	dirty[id] = 1;
+	any_dirty = true;
+	version_dirty = true;
 }
 
 // get local transform of the joint
@@ -49,21 +245,29 @@ Transform Pose::get_local_transform(unsigned int id)
 	return joints[id];
 }
 
+const std::vector<Transform>& Pose::get_local_transforms() const
+{
+	return joints;
+}
+
 // get global (world) transform of the joint
 Transform Pose::get_global_transform(unsigned int id)
 {
-	// use "combine()" function to combine two transforms
-	Transform transform = joints[id];
-	for (int i = parents[id]; i >= 0; i = parents[i]) {
-		transform = combine(joints[i], transform);
-	}
-	return transform;
+	update_global_cache();
+	return global_joints[id];
+}
+
+// get global (world) transform of all the joints: the parent is always computed before its children
+void Pose::get_global_transforms(std::vector<Transform>& out)
+{
+	update_global_cache();
+	out = global_joints;
 }
 
 mat4 Pose::get_global_matrix(unsigned int id)
 {
-	Transform t = get_global_transform(id);
-	return transform_to_mat4(t);
+	update_global_cache();
+	return global_matrices[id];
 }
 
 Transform Pose::operator[](unsigned int index)
@@ -72,19 +276,49 @@ Transform Pose::operator[](unsigned int index)
 }
 
 // get global matrices of the joints
-std::vector<mat4> Pose::get_global_matrices()
+const std::vector<mat4>& Pose::get_global_matrices()
 {
-	unsigned int num_joints = size();
-	std::vector<mat4> out(num_joints);
-	if (out.size() != num_joints) {
-		out.resize(num_joints);
-	}
+	// Only the joints modified since the last query (and their children) are re-evaluated
+	update_global_cache();
+	return global_matrices;
+}
 
-	// For every joint, find the global transform (using get_global_transform), convert it into a matrix, and store the result in a vector of matrices
-	for (unsigned int i = 0; i < num_joints; i++) {
-		Transform t = get_global_transform(i);
-		out[i] = transform_to_mat4(t);
-	}
+PoseView::PoseView() { }
+
+PoseView::PoseView(Pose& pose)
+{
+	global_matrices = pose.get_global_matrices();
+	joints = pose.get_local_transforms();
+	parents = pose.get_parents();
+	version = pose.get_version();
+}
+
+unsigned int PoseView::size() const
+{
+	return (unsigned int)joints.size();
+}
+
+int PoseView::get_parent(unsigned int id) const
+{
+	return parents[id];
+}
 
-	return out;
+const Transform& PoseView::get_local_transform(unsigned int id) const
+{
+	return joints[id];
+}
+
+const mat4& PoseView::get_global_matrix(unsigned int id) const
+{
+	return global_matrices[id];
+}
+
+std::span<const mat4> PoseView::get_global_matrices() const
+{
+	return global_matrices;
+}
+
+uint64_t PoseView::get_version() const
+{
+	return version;
 }
\ No newline at end of file
@@ -1,23 +1,57 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
+#include "rig.h"
 #include "../math/transform.h"
 
 // Used to hold the transformation of every bone in an animated hierarchy
+// Several threads can query a pose at once (the first one evaluates the dirty joints), but it must not be modified meanwhile
 class Pose
 {
 protected:
 	// local transforms (relative to its parent)
 	std::vector<Transform> joints;
-	// parent joints Id (index in the joints array)
-	std::vector<int> parents;
+	// hierarchy of the joints (parents, children, names and evaluation order), shared with the copies of the pose and the other poses of the skeleton
+	std::shared_ptr<const Rig> rig;
+	// parents edited with set_parent or resize: the new rig is built once, the next time the hierarchy is needed
+	std::vector<int> edited_parents;
+	bool rig_dirty = false;
+
+	// cached global transforms and matrices. Only the dirty joints and their descendants are re-evaluated on the next global query
+	std::vector<Transform> global_joints;
+	std::vector<mat4> global_matrices;
+	std::vector<unsigned char> dirty;
+	bool any_dirty = false;
+
+	// changes every time the pose is modified and is unique among all the poses (a copy keeps it, as it holds the same data)
+	// Writing the joints only marks it dirty: the new version is taken once, when it is queried, so the poses updated in parallel
+	// do not all increment last_version for every joint
+	mutable uint64_t version = 0;
+	mutable bool version_dirty = false;
+	static std::atomic<uint64_t> last_version;
+	void update_version();
+
+	std::vector<int>& edit_parents();
+	void update_rig();
+	void set_all_dirty();
+	void update_global_cache();
 
 public:
+	// number of joints re-evaluated by all the poses (reset every frame by the application)
+	static std::atomic<unsigned int> num_evaluated_joints;
+
 	Pose(); // Empty constructor
-	// Initialize the pose given another pose
-	Pose(const Pose& p);
 	// Initialize the pose given the number of joints of the pose
 	Pose(unsigned int num_joints);
+	// Copies reuse the memory already allocated by the destination, moves steal the arrays of the source
+	Pose(const Pose& p) = default;
+	Pose(Pose&& p) noexcept = default;
+	Pose& operator=(const Pose& p) = default;
+	Pose& operator=(Pose&& p) noexcept = default;
 
 	// Resize the array of joints and of parents id
 	void resize(unsigned int size);
@@ -25,16 +59,61 @@ public:
 
 	void set_parent(unsigned int id, unsigned int parent_id);
 	int get_parent(unsigned int id);
+	const std::vector<int>& get_parents();
+
+	// Get the hierarchy of the pose
+	const std::shared_ptr<const Rig>& get_rig();
+	// Use the hierarchy of another pose of the same skeleton instead of a copy of it (it must have the same number of joints)
+	void set_rig(const std::shared_ptr<const Rig>& rig);
+
+	// Get the version of the pose, so the results computed from it can be cached (see Skeleton::get_skin_matrices)
+	uint64_t get_version() const;
+
+	// Check if every joint is stored after its parent (required for the single pass evaluation without remapping)
+	bool is_topologically_sorted();
+	// Get the joints ids in evaluation order (parents before children)
+	const std::vector<unsigned int>& get_evaluation_order();
+	// Reorder the joints given a remap table (remap[old_id] = new_id)
+	void remap(const std::vector<unsigned int>& remap);
+	// Get the remap table (remap[old_id] = new_id) that stores the joints parents first (see Rig::get_topological_remap)
+	static std::vector<unsigned int> get_topological_remap(const std::vector<int>& parents);
 
-	// Set the transformation for the joint given its id
+	// Set the transformation for the joint given its id (the joint and its children will be re-evaluated on the next global query)
 	void set_local_transform(unsigned int id, const Transform& transform);
 	// Get the transformation of the joint given its id
 	Transform get_local_transform(unsigned int id);
+	// Get the local transformation of all the joints
+	const std::vector<Transform>& get_local_transforms() const;
 	// Get the global transformation (world space) of the joint 
 	Transform get_global_transform(unsigned int id);
+	// Get the global transformation (world space) of all the joints in a single pass, reusing the global transform of the parent
+	void get_global_transforms(std::vector<Transform>& out);
 	// Get the global transformation matrix (world space) of all the joints
-	std::vector<mat4> get_global_matrices();
+	const std::vector<mat4>& get_global_matrices();
 	// Get the global transformation matrix (world space) of a specific joint 
 	mat4 get_global_matrix(unsigned int id);
 	Transform operator[](unsigned int index);
+};
+
+// Read-only view of a pose that does not own or copy anything: the local transforms, the parents and the global matrices of its joints
+// Creating it evaluates the global matrices of the pose. It is invalid once the pose is modified, resized or destroyed
+class PoseView
+{
+protected:
+	std::span<const Transform> joints;
+	std::span<const int> parents;
+	std::span<const mat4> global_matrices;
+	uint64_t version = 0;
+
+public:
+	PoseView(); // Empty view
+	PoseView(Pose& pose);
+
+	unsigned int size() const;
+	int get_parent(unsigned int id) const;
+	const Transform& get_local_transform(unsigned int id) const;
+	const mat4& get_global_matrix(unsigned int id) const;
+	std::span<const mat4> get_global_matrices() const;
+	// Version of the pose when the view was created
+	uint64_t get_version() const;
 };
\ No newline at end of file
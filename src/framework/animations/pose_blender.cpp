@@ -0,0 +1,152 @@
+#include "pose_blender.h"
+
+#include <algorithm>
+
+BoneMask::BoneMask(unsigned int num_joints, float weight)
+{
+	// padded so a full SIMD block can always be read after the last joint
+	weights.assign(simd_padded_size(num_joints) + SIMD_WIDTH, weight);
+}
+
+void BoneMask::set_subtree(const Rig& rig, unsigned int joint_id, float weight)
+{
+	std::vector<unsigned int> stack = { joint_id };
+	while (!stack.empty()) {
+		unsigned int id = stack.back();
+		stack.pop_back();
+		weights[id] = weight;
+		for (unsigned int child : rig.get_children(id)) {
+			stack.push_back(child);
+		}
+	}
+}
+
+void PoseBlender::clear()
+{
+	layers.clear();
+	additive_layers.clear();
+	pose_streams.clear();
+}
+
+const TransformStreams* PoseBlender::get_streams(Pose& pose)
+{
+	pose_streams.push_back(acquire_pooled<TransformStreams>());
+	pose_streams.back()->assign(pose.get_local_transforms());
+	return pose_streams.back().get();
+}
+
+void PoseBlender::add_layer(const TransformStreams& pose, float weight, const BoneMask* mask)
+{
+	layers.push_back({ &pose, weight, mask });
+}
+
+void PoseBlender::add_layer(Pose& pose, float weight, const BoneMask* mask)
+{
+	layers.push_back({ get_streams(pose), weight, mask });
+}
+
+void PoseBlender::add_additive_layer(const TransformStreams& delta, float weight, const BoneMask* mask)
+{
+	additive_layers.push_back({ &delta, weight, mask });
+}
+
+simd_transform PoseBlender::blend_block(unsigned int k) const
+{
+	const simd_float zero = simd_set1(0.0f);
+	const simd_float epsilon = simd_set1(1e-6f);
+	auto get_block_weight = [](const Layer& layer, unsigned int k) {
+		simd_float weight = simd_set1(layer.weight);
+		return layer.mask ? simd_mul(weight, simd_loadu(&layer.mask->weights[k])) : weight;
+	};
+
+	// weighted sum of the layers. The rotations are summed in the hemisphere of the first layer, so they take the shortest path
+	simd_transform first = layers[0].pose->load_block(k);
+	simd_transform sum = { zero, zero, zero, zero, zero, zero, zero, zero, zero, zero };
+	simd_float total = zero;
+	for (const Layer& layer : layers) {
+		simd_float w = get_block_weight(layer, k);
+		simd_transform b = layer.pose->load_block(k);
+		simd_float flip = simd_sign_mask(simd_madd(first.rx, b.rx, simd_madd(first.ry, b.ry, simd_madd(first.rz, b.rz, simd_mul(first.rw, b.rw)))));
+		simd_float w_rotation = simd_xor(w, flip);
+
+		sum.px = simd_madd(w, b.px, sum.px); sum.py = simd_madd(w, b.py, sum.py); sum.pz = simd_madd(w, b.pz, sum.pz);
+		sum.rx = simd_madd(w_rotation, b.rx, sum.rx); sum.ry = simd_madd(w_rotation, b.ry, sum.ry);
+		sum.rz = simd_madd(w_rotation, b.rz, sum.rz); sum.rw = simd_madd(w_rotation, b.rw, sum.rw);
+		sum.sx = simd_madd(w, b.sx, sum.sx); sum.sy = simd_madd(w, b.sy, sum.sy); sum.sz = simd_madd(w, b.sz, sum.sz);
+		total = simd_add(total, w);
+	}
+
+	// normalize by the total weight of each joint (the joints without weight keep the first layer)
+	simd_float has_weight = simd_greater_equal(total, epsilon);
+	simd_float inv_total = simd_div(simd_set1(1.0f), simd_max(total, epsilon));
+	simd_float len_sq = simd_madd(sum.rx, sum.rx, simd_madd(sum.ry, sum.ry, simd_madd(sum.rz, sum.rz, simd_mul(sum.rw, sum.rw))));
+	simd_float inv_len = simd_div(simd_set1(1.0f), simd_sqrt(simd_max(len_sq, simd_set1(1e-12f))));
+
+	simd_transform out;
+	out.px = simd_select(has_weight, simd_mul(sum.px, inv_total), first.px);
+	out.py = simd_select(has_weight, simd_mul(sum.py, inv_total), first.py);
+	out.pz = simd_select(has_weight, simd_mul(sum.pz, inv_total), first.pz);
+	out.rx = simd_select(has_weight, simd_mul(sum.rx, inv_len), first.rx);
+	out.ry = simd_select(has_weight, simd_mul(sum.ry, inv_len), first.ry);
+	out.rz = simd_select(has_weight, simd_mul(sum.rz, inv_len), first.rz);
+	out.rw = simd_select(has_weight, simd_mul(sum.rw, inv_len), first.rw);
+	out.sx = simd_select(has_weight, simd_mul(sum.sx, inv_total), first.sx);
+	out.sy = simd_select(has_weight, simd_mul(sum.sy, inv_total), first.sy);
+	out.sz = simd_select(has_weight, simd_mul(sum.sz, inv_total), first.sz);
+
+	// additive layers: position and scale + weight * delta, rotation * nlerp(identity, delta, weight)
+	const simd_float one = simd_set1(1.0f);
+	for (const Layer& layer : additive_layers) {
+		simd_float w = get_block_weight(layer, k);
+		simd_transform d = layer.pose->load_block(k);
+		out.px = simd_madd(w, d.px, out.px); out.py = simd_madd(w, d.py, out.py); out.pz = simd_madd(w, d.pz, out.pz);
+		out.sx = simd_madd(w, d.sx, out.sx); out.sy = simd_madd(w, d.sy, out.sy); out.sz = simd_madd(w, d.sz, out.sz);
+
+		simd_float x, y, z, q;
+		simd_nlerp(zero, zero, zero, one, d.rx, d.ry, d.rz, d.rw, w, x, y, z, q);
+		simd_quat_mul(out.rx, out.ry, out.rz, out.rw, x, y, z, q, out.rx, out.ry, out.rz, out.rw);
+	}
+	return out;
+}
+
+void PoseBlender::blend(unsigned int num_joints, TransformStreams& out) const
+{
+	if (layers.empty()) {
+		return;
+	}
+	out.resize(num_joints);
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		out.store_block(k, blend_block(k));
+	}
+}
+
+void PoseBlender::blend(Pose& out) const
+{
+	if (layers.empty()) {
+		return;
+	}
+
+	unsigned int num_joints = out.size();
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		store_to_pose(blend_block(k), k, std::min((unsigned int)SIMD_WIDTH, num_joints - k), nullptr, out);
+	}
+}
+
+void PoseBlender::make_additive(const TransformStreams& pose, const TransformStreams& reference, unsigned int num_joints, TransformStreams& out)
+{
+	out.resize(num_joints);
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		simd_transform p = pose.load_block(k);
+		simd_transform r = reference.load_block(k);
+		simd_transform d;
+		d.px = simd_sub(p.px, r.px); d.py = simd_sub(p.py, r.py); d.pz = simd_sub(p.pz, r.pz);
+		d.sx = simd_sub(p.sx, r.sx); d.sy = simd_sub(p.sy, r.sy); d.sz = simd_sub(p.sz, r.sz);
+
+		// rotation = inverse(reference) * pose, with w >= 0 so it takes the shortest path
+		simd_float sign = simd_set1(-0.0f);
+		simd_quat_mul(simd_xor(r.rx, sign), simd_xor(r.ry, sign), simd_xor(r.rz, sign), r.rw, p.rx, p.ry, p.rz, p.rw, d.rx, d.ry, d.rz, d.rw);
+		simd_float flip = simd_sign_mask(d.rw);
+		d.rx = simd_xor(d.rx, flip); d.ry = simd_xor(d.ry, flip); d.rz = simd_xor(d.rz, flip); d.rw = simd_xor(d.rw, flip);
+		out.store_block(k, d);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include "pose_soa.h"
+#include "../object_pool.h"
+
+// Weight of every joint of a blend layer (1 to blend the joint fully, 0 to ignore it)
+struct BoneMask
+{
+	aligned_vector<float> weights; // padded like the TransformStreams
+
+	BoneMask(unsigned int num_joints = 0, float weight = 1.0f);
+	// Set the weight of a joint and all its descendants (e.g. only the upper body from the spine)
+	void set_subtree(const Rig& rig, unsigned int joint_id, float weight);
+};
+
+// Blends the local transforms of any number of poses in a single pass over the joints, SIMD_WIDTH joints at a time:
+// the weighted average of the layers (normalized per joint) and then the additive layers on top of it
+// The poses are given as TransformStreams in joint order. They are not copied, so they must live until blend is called
+class PoseBlender
+{
+protected:
+	struct Layer
+	{
+		const TransformStreams* pose = nullptr;
+		float weight = 0.0f;
+		const BoneMask* mask = nullptr;
+	};
+	std::vector<Layer> layers;
+	std::vector<Layer> additive_layers;
+	// streams of the layers given as a Pose, kept until clear
+	std::vector<Pooled<TransformStreams>> pose_streams;
+
+	const TransformStreams* get_streams(Pose& pose);
+	simd_transform blend_block(unsigned int k) const;
+
+public:
+	// Remove all the layers
+	void clear();
+
+	// Add a pose to the weighted average (the mask, if any, scales the weight of every joint)
+	void add_layer(const TransformStreams& pose, float weight, const BoneMask* mask = nullptr);
+	void add_layer(Pose& pose, float weight, const BoneMask* mask = nullptr);
+	// Add a delta (see make_additive) on top of the average, scaled by the weight: 0 does nothing and 1 applies it fully
+	void add_additive_layer(const TransformStreams& delta, float weight, const BoneMask* mask = nullptr);
+
+	// Blend the layers into the first num_joints transforms. The joints without weight in any layer take the first layer
+	void blend(unsigned int num_joints, TransformStreams& out) const;
+	// Blend the layers into the local transforms of the pose
+	void blend(Pose& out) const;
+
+	// Get the difference of the pose from the reference pose, to add it to other poses with an additive layer
+	// (e.g. a breathing clip relative to its first frame)
+	static void make_additive(const TransformStreams& pose, const TransformStreams& reference, unsigned int num_joints, TransformStreams& out);
+};
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "pose_soa.h"
+#include "../math/batch.h"
+
+#include <algorithm>
+
+void TransformStreams::resize(unsigned int size)
+{
+	// padded so a full SIMD block can always be read after the last element
+	unsigned int padded_size = simd_padded_size(size) + SIMD_WIDTH;
+	px.resize(padded_size, 0.f); py.resize(padded_size, 0.f); pz.resize(padded_size, 0.f);
+	rx.resize(padded_size, 0.f); ry.resize(padded_size, 0.f); rz.resize(padded_size, 0.f); rw.resize(padded_size, 1.f);
+	sx.resize(padded_size, 1.f); sy.resize(padded_size, 1.f); sz.resize(padded_size, 1.f);
+}
+
+void TransformStreams::set(unsigned int id, const Transform& t)
+{
+	px[id] = t.position.x; py[id] = t.position.y; pz[id] = t.position.z;
+	rx[id] = t.rotation.x; ry[id] = t.rotation.y; rz[id] = t.rotation.z; rw[id] = t.rotation.w;
+	sx[id] = t.scale.x; sy[id] = t.scale.y; sz[id] = t.scale.z;
+}
+
+Transform TransformStreams::get(unsigned int id) const
+{
+	return Transform(
+		vec3(px[id], py[id], pz[id]),
+		quat(rx[id], ry[id], rz[id], rw[id]),
+		vec3(sx[id], sy[id], sz[id])
+	);
+}
+
+void TransformStreams::assign(const std::vector<Transform>& transforms)
+{
+	resize((unsigned int)transforms.size());
+	for (unsigned int i = 0; i < transforms.size(); i++) {
+		set(i, transforms[i]);
+	}
+}
+
+void store_to_pose(const simd_transform& block, unsigned int first, unsigned int count, const unsigned int* joint_ids, Pose& pose)
+{
+	alignas(SIMD_ALIGNMENT) float lanes[10][SIMD_WIDTH];
+	store_lanes(block, lanes);
+	unsigned int num_joints = pose.size();
+	for (unsigned int lane = 0; lane < count; lane++) {
+		unsigned int joint_id = joint_ids ? joint_ids[first + lane] : first + lane;
+		if (joint_id < num_joints) {
+			pose.set_local_transform(joint_id, Transform(
+				vec3(lanes[0][lane], lanes[1][lane], lanes[2][lane]),
+				quat(lanes[3][lane], lanes[4][lane], lanes[5][lane], lanes[6][lane]),
+				vec3(lanes[7][lane], lanes[8][lane], lanes[9][lane])
+			));
+		}
+	}
+}
+
+PoseSoA::PoseSoA() { }
+
+PoseSoA::PoseSoA(Pose& pose)
+{
+	from_pose(pose);
+}
+
+void PoseSoA::from_pose(Pose& pose)
+{
+	num_joints = pose.size();
+
+	// depth of every joint (the evaluation order guarantees the parent depth is already known)
+	const std::vector<unsigned int>& order = pose.get_evaluation_order();
+	std::vector<unsigned int> depth(num_joints, 0);
+	for (unsigned int k = 0; k < num_joints; k++) {
+		unsigned int i = order[k];
+		int parent_id = pose.get_parent(i);
+		if (parent_id >= 0 && parent_id < (int)num_joints) {
+			depth[i] = depth[parent_id] + 1;
+		}
+	}
+
+	// group the joints by depth, keeping the evaluation order inside each level
+	soa_to_pose = order;
+	std::stable_sort(soa_to_pose.begin(), soa_to_pose.end(), [&depth](unsigned int a, unsigned int b) { return depth[a] < depth[b]; });
+
+	pose_to_soa.resize(num_joints);
+	for (unsigned int k = 0; k < num_joints; k++) {
+		pose_to_soa[soa_to_pose[k]] = k;
+	}
+
+	// padded with valid ids, so the gathers of an incomplete block never read out of the streams
+	parents.assign(simd_padded_size(num_joints) + SIMD_WIDTH, 0);
+	levels.clear();
+	for (unsigned int k = 0; k < num_joints; k++) {
+		unsigned int i = soa_to_pose[k];
+		int parent_id = pose.get_parent(i);
+		parents[k] = (parent_id >= 0 && parent_id < (int)num_joints) ? (int)pose_to_soa[parent_id] : -1;
+		if (k == 0 || depth[i] != depth[soa_to_pose[k - 1]]) {
+			levels.push_back(k);
+		}
+	}
+	levels.push_back(num_joints);
+
+	locals.resize(num_joints);
+	globals.resize(num_joints);
+	for (unsigned int k = 0; k < num_joints; k++) {
+		locals.set(k, pose.get_local_transform(soa_to_pose[k]));
+	}
+	globals_dirty = true;
+}
+
+void PoseSoA::to_pose(Pose& pose)
+{
+	if (pose.size() != num_joints) {
+		pose.resize(num_joints);
+		for (unsigned int k = 0; k < num_joints; k++) {
+			pose.set_parent(soa_to_pose[k], parents[k] < 0 ? -1 : soa_to_pose[parents[k]]);
+		}
+	}
+	for (unsigned int k = 0; k < num_joints; k++) {
+		pose.set_local_transform(soa_to_pose[k], locals.get(k));
+	}
+}
+
+unsigned int PoseSoA::size()
+{
+	return num_joints;
+}
+
+void PoseSoA::set_local_transform(unsigned int id, const Transform& transform)
+{
+	locals.set(pose_to_soa[id], transform);
+	globals_dirty = true;
+}
+
+Transform PoseSoA::get_local_transform(unsigned int id)
+{
+	return locals.get(pose_to_soa[id]);
+}
+
+Transform PoseSoA::get_global_transform(unsigned int id)
+{
+	compute_globals();
+	return globals.get(pose_to_soa[id]);
+}
+
+const std::vector<unsigned int>& PoseSoA::get_soa_ids() const
+{
+	return pose_to_soa;
+}
+
+TransformStreams& PoseSoA::edit_local_streams()
+{
+	globals_dirty = true;
+	return locals;
+}
+
+// SIMD_WIDTH transforms of the streams gathered by id
+static SIMD_INLINE simd_transform gather_block(const TransformStreams& t, const int* ids)
+{
+	simd_transform block;
+	block.px = simd_gather(t.px.data(), ids); block.py = simd_gather(t.py.data(), ids); block.pz = simd_gather(t.pz.data(), ids);
+	block.rx = simd_gather(t.rx.data(), ids); block.ry = simd_gather(t.ry.data(), ids); block.rz = simd_gather(t.rz.data(), ids); block.rw = simd_gather(t.rw.data(), ids);
+	block.sx = simd_gather(t.sx.data(), ids); block.sy = simd_gather(t.sy.data(), ids); block.sz = simd_gather(t.sz.data(), ids);
+	return block;
+}
+
+void PoseSoA::compute_globals()
+{
+	if (!globals_dirty) {
+		return;
+	}
+
+	// the roots (first level) have no parent
+	unsigned int num_roots = levels.size() > 1 ? levels[1] : 0;
+	for (unsigned int k = 0; k < num_roots; k++) {
+		globals.set(k, locals.get(k));
+	}
+
+	// the joints of a level only read the globals of the previous levels. The last block of a level may also compute some joints
+	// of the next level with not yet valid parents, but they are computed again (and correctly) with their own level
+	for (unsigned int level = 1; level + 1 < levels.size(); level++) {
+		for (unsigned int k = levels[level]; k < levels[level + 1]; k += SIMD_WIDTH) {
+			globals.store_block(k, simd_combine(gather_block(globals, &parents[k]), locals.load_block(k)));
+		}
+	}
+
+	globals_dirty = false;
+}
+
+void PoseSoA::get_global_matrices(std::vector<mat4>& out)
+{
+	compute_globals();
+	out.resize(num_joints);
+
+	// the 16 components of SIMD_WIDTH matrices: columns[16][SIMD_WIDTH]
+	alignas(SIMD_ALIGNMENT) float columns[16 * SIMD_WIDTH];
+	simd_float m[16];
+	for (unsigned int k = 0; k < num_joints; k += SIMD_WIDTH) {
+		simd_transform_to_mat4(globals.load_block(k), m);
+		for (unsigned int c = 0; c < 16; c++) {
+			simd_store(columns + c * SIMD_WIDTH, m[c]);
+		}
+		unsigned int block_size = std::min((unsigned int)SIMD_WIDTH, num_joints - k);
+		for (unsigned int lane = 0; lane < block_size; lane++) {
+			mat4& m = out[soa_to_pose[k + lane]];
+			for (unsigned int c = 0; c < 16; c++) {
+				m.data[c] = columns[c * SIMD_WIDTH + lane];
+			}
+		}
+	}
+}
+
+void PoseSoA::get_skin_matrices(const std::vector<mat4>& inv_bind_pose, std::vector<mat4>& out)
+{
+	get_global_matrices(out);
+	multiply(out.data(), inv_bind_pose.data(), out.data(), num_joints);
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include "pose.h"
+#include "../math/simd_transform.h"
+
+// Array of transforms stored as a structure of arrays (one aligned stream per component), so SIMD_WIDTH transforms can be processed at once
+struct TransformStreams
+{
+	aligned_vector<float> px, py, pz;		// position
+	aligned_vector<float> rx, ry, rz, rw;	// rotation
+	aligned_vector<float> sx, sy, sz;		// scale
+
+	void resize(unsigned int size);
+	void set(unsigned int id, const Transform& t);
+	Transform get(unsigned int id) const;
+	// Resize and copy all the transforms
+	void assign(const std::vector<Transform>& transforms);
+
+	// SIMD_WIDTH consecutive transforms starting at k
+	SIMD_INLINE simd_transform load_block(unsigned int k) const
+	{
+		simd_transform block;
+		block.px = simd_loadu(&px[k]); block.py = simd_loadu(&py[k]); block.pz = simd_loadu(&pz[k]);
+		block.rx = simd_loadu(&rx[k]); block.ry = simd_loadu(&ry[k]); block.rz = simd_loadu(&rz[k]); block.rw = simd_loadu(&rw[k]);
+		block.sx = simd_loadu(&sx[k]); block.sy = simd_loadu(&sy[k]); block.sz = simd_loadu(&sz[k]);
+		return block;
+	}
+
+	SIMD_INLINE void store_block(unsigned int k, const simd_transform& block)
+	{
+		simd_storeu(&px[k], block.px); simd_storeu(&py[k], block.py); simd_storeu(&pz[k], block.pz);
+		simd_storeu(&rx[k], block.rx); simd_storeu(&ry[k], block.ry); simd_storeu(&rz[k], block.rz); simd_storeu(&rw[k], block.rw);
+		simd_storeu(&sx[k], block.sx); simd_storeu(&sy[k], block.sy); simd_storeu(&sz[k], block.sz);
+	}
+};
+
+// The 10 components of the SIMD_WIDTH transforms of a block: lanes[component][lane]
+SIMD_INLINE void store_lanes(const simd_transform& block, float lanes[10][SIMD_WIDTH])
+{
+	simd_store(lanes[0], block.px); simd_store(lanes[1], block.py); simd_store(lanes[2], block.pz);
+	simd_store(lanes[3], block.rx); simd_store(lanes[4], block.ry); simd_store(lanes[5], block.rz); simd_store(lanes[6], block.rw);
+	simd_store(lanes[7], block.sx); simd_store(lanes[8], block.sy); simd_store(lanes[9], block.sz);
+}
+
+// Write the first count lanes of a block of transforms to the local transforms of the pose: lane i is the joint joint_ids[first + i],
+// or first + i without joint_ids. The ids out of the pose are skipped
+void store_to_pose(const simd_transform& block, unsigned int first, unsigned int count, const unsigned int* joint_ids, Pose& pose);
+
+// Pose stored as a structure of arrays. The joints are grouped by depth in the hierarchy, so all the joints of a level
+// only depend on the previous levels and can be combined with their parents with SIMD
+class PoseSoA
+{
+protected:
+	unsigned int num_joints = 0;
+
+	std::vector<unsigned int> soa_to_pose;	// joint id in the pose of each soa index
+	std::vector<unsigned int> pose_to_soa;	// soa index of each joint id of the pose
+	std::vector<int> parents;				// parent soa index of each soa index (-1 for the roots)
+	std::vector<unsigned int> levels;		// first soa index of each depth level (the last one is the number of joints)
+
+	TransformStreams locals;
+	TransformStreams globals;
+	bool globals_dirty = true;
+
+public:
+	PoseSoA(); // Empty constructor
+	// Initialize the SoA pose given a pose
+	PoseSoA(Pose& pose);
+
+	// Copy the hierarchy and the local transforms of the pose
+	void from_pose(Pose& pose);
+	// Copy the local transforms into the pose (the pose is resized and its hierarchy set if it does not match)
+	void to_pose(Pose& pose);
+
+	unsigned int size();
+
+	// ids are the joint ids of the original pose
+	void set_local_transform(unsigned int id, const Transform& transform);
+	Transform get_local_transform(unsigned int id);
+	Transform get_global_transform(unsigned int id);
+	// Get the soa index of each joint id of the pose, to write the local streams directly
+	const std::vector<unsigned int>& get_soa_ids() const;
+	// Get the local transforms in soa order to write them (the globals are re-evaluated on the next query)
+	TransformStreams& edit_local_streams();
+
+	// Compute the global transform of every joint, level by level
+	void compute_globals();
+	// Get the global matrix of every joint (in the joint order of the pose)
+	void get_global_matrices(std::vector<mat4>& out);
+	// Get the skin matrices (global * inverse bind pose) of every joint (in the joint order of the pose)
+	void get_skin_matrices(const std::vector<mat4>& inv_bind_pose, std::vector<mat4>& out);
+};
\ No newline at end of file
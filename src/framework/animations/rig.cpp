@@ -0,0 +1,157 @@
+#include "rig.h"
+
+// a joint with an invalid parent id is treated as a root
+static bool has_parent(const std::vector<int>& parents, unsigned int id)
+{
+	return parents[id] >= 0 && parents[id] < (int)parents.size();
+}
+
+// children of every joint in CSR layout (offsets + one array), keeping the order of the joint ids between siblings
+static void build_children(const std::vector<int>& parents, std::vector<unsigned int>& offsets, std::vector<unsigned int>& children)
+{
+	unsigned int num_joints = (unsigned int)parents.size();
+	offsets.assign(num_joints + 1, 0);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (has_parent(parents, i)) {
+			offsets[parents[i] + 1]++;
+		}
+	}
+	for (unsigned int i = 0; i < num_joints; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	children.resize(offsets[num_joints]);
+	std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (has_parent(parents, i)) {
+			children[next[parents[i]]++] = i;
+		}
+	}
+}
+
+// breadth-first traversal from the roots, keeping the order between siblings
+static void build_order(const std::vector<int>& parents, const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& children, std::vector<unsigned int>& order)
+{
+	unsigned int num_joints = (unsigned int)parents.size();
+	order.clear();
+	order.reserve(num_joints);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (!has_parent(parents, i)) {
+			order.push_back(i);
+		}
+	}
+	for (unsigned int k = 0; k < order.size(); k++) {
+		unsigned int id = order[k];
+		for (unsigned int c = offsets[id]; c < offsets[id + 1]; c++) {
+			order.push_back(children[c]);
+		}
+	}
+
+	// joints that are part of a cycle are never reached: keep them at the end
+	if (order.size() < num_joints) {
+		std::vector<bool> visited(num_joints, false);
+		for (unsigned int k = 0; k < order.size(); k++) {
+			visited[order[k]] = true;
+		}
+		for (unsigned int i = 0; i < num_joints; i++) {
+			if (!visited[i]) {
+				order.push_back(i);
+			}
+		}
+	}
+}
+
+static bool is_sorted(const std::vector<int>& parents)
+{
+	for (unsigned int i = 0; i < parents.size(); i++) {
+		if (parents[i] >= (int)i) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Rig::Rig() { }
+
+Rig::Rig(const std::vector<int>& parents, const std::vector<std::string>& names)
+{
+	this->parents = parents;
+	build_children(parents, child_offsets, children);
+	build_order(parents, child_offsets, children, order);
+	sorted = is_sorted(parents);
+
+	if (names.size() == parents.size()) {
+		this->names = names;
+		name_to_id.reserve(names.size());
+		for (unsigned int i = 0; i < names.size(); i++) {
+			name_to_id.emplace(names[i], i); // the first joint wins if two have the same name
+		}
+	}
+}
+
+unsigned int Rig::size() const
+{
+	return (unsigned int)parents.size();
+}
+
+int Rig::get_parent(unsigned int id) const
+{
+	return parents[id];
+}
+
+const std::vector<int>& Rig::get_parents() const
+{
+	return parents;
+}
+
+std::span<const unsigned int> Rig::get_children(unsigned int id) const
+{
+	return std::span<const unsigned int>(children.data() + child_offsets[id], child_offsets[id + 1] - child_offsets[id]);
+}
+
+const std::vector<std::string>& Rig::get_names() const
+{
+	return names;
+}
+
+const std::string& Rig::get_name(unsigned int id) const
+{
+	static const std::string no_name;
+	return id < names.size() ? names[id] : no_name;
+}
+
+int Rig::find_joint(const std::string& name) const
+{
+	auto it = name_to_id.find(name);
+	return it == name_to_id.end() ? -1 : (int)it->second;
+}
+
+const std::vector<unsigned int>& Rig::get_evaluation_order() const
+{
+	return order;
+}
+
+bool Rig::is_topologically_sorted() const
+{
+	return sorted;
+}
+
+std::vector<unsigned int> Rig::get_topological_remap(const std::vector<int>& parents)
+{
+	unsigned int num_joints = (unsigned int)parents.size();
+	std::vector<unsigned int> remap(num_joints);
+	if (is_sorted(parents)) {
+		for (unsigned int i = 0; i < num_joints; i++) {
+			remap[i] = i;
+		}
+		return remap;
+	}
+
+	std::vector<unsigned int> offsets, children, order;
+	build_children(parents, offsets, children);
+	build_order(parents, offsets, children, order);
+	for (unsigned int k = 0; k < num_joints; k++) {
+		remap[order[k]] = k;
+	}
+	return remap;
+}
\ No newline at end of file
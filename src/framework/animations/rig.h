@@ -0,0 +1,46 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchy of a skeleton: parents, children, names of the joints and the order to evaluate them
+// It never changes once built (a pose builds a new one when its hierarchy is edited), so the same rig can be shared
+// by all the poses and characters of a skeleton, also between threads
+class Rig
+{
+protected:
+	std::vector<int> parents;					// parent id of each joint (-1 for the roots)
+	std::vector<unsigned int> child_offsets;	// children of joint i: children[child_offsets[i]] .. children[child_offsets[i + 1] - 1]
+	std::vector<unsigned int> children;
+	std::vector<std::string> names;				// empty if the joints have no names
+	std::unordered_map<std::string, unsigned int> name_to_id;
+	std::vector<unsigned int> order;			// joint ids sorted so every parent is visited before its children
+	bool sorted = true;							// the joints are already stored parents first
+
+public:
+	Rig(); // Empty rig
+	// Build the rig given the parent id of each joint and optionally their names
+	Rig(const std::vector<int>& parents, const std::vector<std::string>& names = {});
+
+	unsigned int size() const;
+
+	int get_parent(unsigned int id) const;
+	const std::vector<int>& get_parents() const;
+	std::span<const unsigned int> get_children(unsigned int id) const;
+
+	const std::vector<std::string>& get_names() const;
+	// Get the name of the joint (empty if the joints have no names)
+	const std::string& get_name(unsigned int id) const;
+	// Get the id of the joint given its name, or -1 if there is no joint with that name
+	int find_joint(const std::string& name) const;
+
+	// Get the joints ids in evaluation order (parents before children)
+	const std::vector<unsigned int>& get_evaluation_order() const;
+	// Check if every joint is stored after its parent
+	bool is_topologically_sorted() const;
+
+	// Get the remap table (remap[old_id] = new_id) that stores the joints parents first. It is the identity if they are already sorted
+	static std::vector<unsigned int> get_topological_remap(const std::vector<int>& parents);
+};
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "skeleton.h"
+#include "../math/batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 Skeleton::Skeleton() {}
 
@@ -7,11 +12,32 @@ Skeleton::Skeleton(const Pose& rest, const Pose& bind, const std::vector<std::st
 	set(rest, bind, names);
 }
 
+Skeleton::Skeleton(const Skeleton& skeleton)
+{
+	*this = skeleton;
+}
+
+Skeleton& Skeleton::operator=(const Skeleton& skeleton)
+{
+	bind_pose = skeleton.bind_pose;
+	rest_pose = skeleton.rest_pose;
+	inv_bind_pose = skeleton.inv_bind_pose;
+	inv_bind_transforms = skeleton.inv_bind_transforms;
+	rest_palette.dirty = bind_palette.dirty = other_palette.dirty = true;
+	return *this;
+}
+
 void Skeleton::set(const Pose& rest, const Pose& bind, const std::vector<std::string>& names)
 {
 	rest_pose = rest;
 	bind_pose = bind;
-	joint_names = names;
+
+	// a single rig with the names of the joints, shared by both poses
+	std::shared_ptr<const Rig> rig = std::make_shared<const Rig>(rest_pose.get_parents(), names);
+	rest_pose.set_rig(rig);
+	if (bind_pose.get_parents() == rig->get_parents()) {
+		bind_pose.set_rig(rig);
+	}
 	update_inv_bind_pose();
 }
 
@@ -30,22 +56,106 @@ std::vector<mat4>& Skeleton::get_inv_bind_pose()
 	return inv_bind_pose;
 }
 
-std::vector<std::string>& Skeleton::get_joint_names()
+const std::shared_ptr<const Rig>& Skeleton::get_rig()
+{
+	return rest_pose.get_rig();
+}
+
+const std::vector<std::string>& Skeleton::get_joint_names()
 {
-	return joint_names;
+	return get_rig()->get_names();
 }
 
-std::string& Skeleton::get_joint_name(unsigned int id)
+const std::string& Skeleton::get_joint_name(unsigned int id)
 {
-	return joint_names[id];
+	return get_rig()->get_name(id);
 }
 
 void Skeleton::update_inv_bind_pose()
 {
 	unsigned int size = bind_pose.size();
 	inv_bind_pose.resize(size);
+	inv_bind_transforms.resize(size);
+	std::vector<Transform> world;
+	bind_pose.get_global_transforms(world);
 	for (unsigned int i = 0; i < size; ++i) {
-		Transform world = bind_pose.get_global_transform(i);
-		inv_bind_pose[i] = inverse(transform_to_mat4(world));
+		inv_bind_pose[i] = transform_to_inverse_mat4(world[i]);
+		inv_bind_transforms[i] = inverse(world[i]);
+	}
+	rest_palette.dirty = bind_palette.dirty = other_palette.dirty = true;
+}
+
+const std::vector<mat4>& Skeleton::get_skin_matrices(const PoseView& pose)
+{
+	std::lock_guard<std::mutex> lock(skin_mutex);
+	uint64_t version = pose.get_version();
+	SkinPalette& palette = version == rest_pose.get_version() ? rest_palette : (version == bind_pose.get_version() ? bind_palette : other_palette);
+	if (palette.dirty || palette.version != version) {
+		unsigned int size = std::min(pose.size(), (unsigned int)inv_bind_pose.size());
+		palette.matrices.resize(size);
+		multiply(pose.get_global_matrices().data(), inv_bind_pose.data(), palette.matrices.data(), size);
+		palette.version = version;
+		palette.dirty = false;
+	}
+	return palette.matrices;
+}
+
+void Skeleton::get_dual_quat_palette(Pose& pose, std::vector<dual_quat>& out) const
+{
+	unsigned int size = std::min(pose.size(), (unsigned int)inv_bind_transforms.size());
+	out.resize(size);
+	for (unsigned int i = 0; i < size; i++) {
+		out[i] = transform_to_dual_quat(combine(pose.get_global_transform(i), inv_bind_transforms[i]));
+	}
+}
+
+float Skeleton::benchmark_skinning(SkinningMode mode, unsigned int num_joints, unsigned int num_vertices, unsigned int iterations)
+{
+	num_joints = std::max(num_joints, 1u);
+
+	// chain of bones of length 1 along y, bent a little more every iteration
+	Pose bind(num_joints);
+	for (unsigned int i = 0; i < num_joints; i++) {
+		if (i > 0) {
+			bind.set_parent(i, i - 1);
+		}
+		bind.set_local_transform(i, Transform(vec3(0.0f, i > 0 ? 1.0f : 0.0f, 0.0f), quat(), vec3(1.0f, 1.0f, 1.0f)));
+	}
+	Skeleton skeleton(bind, bind, std::vector<std::string>(num_joints));
+	Pose pose = bind;
+
+	// vertices around the chain, weighted by 4 consecutive bones
+	std::vector<vec3> positions(num_vertices), normals(num_vertices), out_positions(num_vertices), out_normals(num_vertices);
+	std::vector<ivec4> bones(num_vertices);
+	std::vector<vec4> weights(num_vertices);
+	for (unsigned int v = 0; v < num_vertices; v++) {
+		float height = (float)(v % (num_joints * 16)) / 16.0f;
+		int bone = (int)height;
+		float angle = v * 0.7f;
+		positions[v] = vec3(cosf(angle) * 0.2f, height, sinf(angle) * 0.2f);
+		normals[v] = vec3(cosf(angle), 0.0f, sinf(angle));
+		bones[v] = ivec4(bone, std::min(bone + 1, (int)num_joints - 1), std::max(bone - 1, 0), std::min(bone + 2, (int)num_joints - 1));
+		weights[v] = vec4(0.4f, 0.3f, 0.2f, 0.1f);
+	}
+
+	std::vector<dual_quat> dual_quats;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int it = 0; it < iterations; it++) {
+		quat bend = angle_axis(0.01f * (it + 1), vec3(0.0f, 0.0f, 1.0f));
+		for (unsigned int i = 1; i < num_joints; i++) {
+			Transform local = pose.get_local_transform(i);
+			local.rotation = bend;
+			pose.set_local_transform(i, local);
+		}
+		if (mode == SKINNING_DUAL_QUAT) {
+			skeleton.get_dual_quat_palette(pose, dual_quats);
+			skin(dual_quats.data(), positions.data(), normals.data(), bones.data(), weights.data(), out_positions.data(), out_normals.data(), num_vertices);
+		}
+		else {
+			const std::vector<mat4>& matrices = skeleton.get_skin_matrices(PoseView(pose));
+			skin(matrices.data(), positions.data(), normals.data(), bones.data(), weights.data(), out_positions.data(), out_normals.data(), num_vertices);
+		}
 	}
+	float microseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	return iterations > 0 ? microseconds / iterations : 0.0f;
 }
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <mutex>
 #include <string>
 #include "pose.h"
+#include "../math/dual_quat.h"
+
+// How the vertices blend the transforms of their bones: linear blend skinning (the weighted sum of the skin matrices, which collapses
+// the volume around twisted joints) or dual quaternion skinning (the normalized weighted sum of the skin transforms as dual
+// quaternions, which keeps it but ignores the scale of the joints)
+enum SkinningMode { SKINNING_LINEAR, SKINNING_DUAL_QUAT };
 
 class Skeleton
 {
@@ -10,7 +17,20 @@ protected:
 	Pose rest_pose;
 	
 	std::vector<mat4> inv_bind_pose; // vector of inverse bind pose matrix of each joint
-	std::vector<std::string> joint_names; // vector of the name of each joint
+	std::vector<Transform> inv_bind_transforms; // the same as transforms (for the dual quaternions)
+
+	struct SkinPalette
+	{
+		std::vector<mat4> matrices;
+		uint64_t version = 0; // of the pose
+		bool dirty = true;
+	};
+	// skin matrices of the rest pose, of the bind pose and of the last other pose given to get_skin_matrices. The first two only change
+	// with their pose, so the entities updated in parallel that show them only read them
+	SkinPalette rest_palette;
+	SkinPalette bind_palette;
+	SkinPalette other_palette;
+	std::mutex skin_mutex;
 
 	// updates the inverse bind pose matrices: any time the bind pose of the skeleton is updated, the inverse bind pose should be re-calculated as well
 	void update_inv_bind_pose();
@@ -19,13 +39,32 @@ public:
 	Skeleton(); // Empty constructor
 	// Initialize the skeleton given the rest and bind poses, and the names of the joints
 	Skeleton(const Pose& rest, const Pose& bind, const std::vector<std::string>& names);
+	// Copies compute their own skin matrices
+	Skeleton(const Skeleton& skeleton);
+	Skeleton& operator=(const Skeleton& skeleton);
 
 	void set(const Pose& rest, const Pose& bind, const std::vector<std::string>& names);
 
 	Pose& get_bind_pose();
 	Pose& get_rest_pose();
 
+	// Get the hierarchy and the names of the joints (shared by the rest pose, the bind pose and their copies)
+	const std::shared_ptr<const Rig>& get_rig();
+
 	std::vector<mat4>& get_inv_bind_pose();
-	std::vector<std::string>& get_joint_names();
-	std::string& get_joint_name(unsigned int id);
+	const std::vector<std::string>& get_joint_names();
+	const std::string& get_joint_name(unsigned int id);
+
+	// Get the skin matrices (global matrix * inverse bind pose matrix) of every joint for the pose. They are only computed again
+	// if the pose (or its version) changes, so every mesh skinned with the skeleton shares the same matrices. Can be called from
+	// several threads: the matrices of the rest and the bind pose (or their copies) stay valid until those poses change, the ones of
+	// any other pose until the next call with another pose
+	const std::vector<mat4>& get_skin_matrices(const PoseView& pose);
+	// Get the skin transforms (global transform combined with the inverse bind pose transform) of every joint for the pose as dual
+	// quaternions, 8 floats per joint instead of 16. They are written to out, so each entity can keep its own (and build it in parallel)
+	void get_dual_quat_palette(Pose& pose, std::vector<dual_quat>& out) const;
+
+	// Microseconds to build the palette of a pose of a chain of num_joints joints and skin num_vertices vertices with it (4 bones each)
+	// in one thread, on average over the iterations
+	static float benchmark_skinning(SkinningMode mode, unsigned int num_joints, unsigned int num_vertices, unsigned int iterations = 100);
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "track.h"
+
+#include <algorithm>
+#include <cmath>
+
+vec3 interpolate(const vec3& a, const vec3& b, float t)
+{
+	return lerp(a, b, t);
+}
+
+quat interpolate(const quat& a, const quat& b, float t)
+{
+	if (dot(a, b) < 0.0f) {
+		return nlerp(a, -b, t);
+	}
+	return nlerp(a, b, t);
+}
+
+unsigned int find_key(const std::vector<float>& times, float time, unsigned int& cursor)
+{
+	unsigned int num_keys = (unsigned int)times.size();
+
+	// sequential playback: the time is in the same key as before or in the next one
+	if (cursor + 1 < num_keys && times[cursor] <= time) {
+		if (time < times[cursor + 1]) {
+			return cursor;
+		}
+		if (cursor + 2 < num_keys && time < times[cursor + 2]) {
+			return ++cursor;
+		}
+	}
+
+	// random seek
+	unsigned int key = (unsigned int)(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+	cursor = std::clamp(key, 1u, num_keys - 1) - 1;
+	return cursor;
+}
+
+float adjust_time(float time, float start_time, float end_time, bool looping)
+{
+	float duration = end_time - start_time;
+	if (duration <= 0.0f) {
+		return start_time;
+	}
+	if (looping) {
+		time = fmodf(time - start_time, duration);
+		if (time < 0.0f) {
+			time += duration;
+		}
+		return time + start_time;
+	}
+	return std::clamp(time, start_time, end_time);
+}
+
+// the result of a cubic interpolation of quaternions is not unit length
+static vec3 adjust(const vec3& v)
+{
+	return v;
+}
+
+static quat adjust(const quat& q)
+{
+	return normalized(q);
+}
+
+// Hermite spline between p1 and p2 with the tangents s1 and s2 (already scaled by the duration of the segment)
+template <typename T>
+static T hermite(float t, const T& p1, const T& s1, const T& p2, const T& s2)
+{
+	float tt = t * t;
+	float ttt = tt * t;
+	float h1 = 2.0f * ttt - 3.0f * tt + 1.0f;
+	float h2 = -2.0f * ttt + 3.0f * tt;
+	float h3 = ttt - 2.0f * tt + t;
+	float h4 = ttt - tt;
+	return adjust(p1 * h1 + p2 * h2 + s1 * h3 + s2 * h4);
+}
+
+template <typename T>
+Track<T>::Track() { }
+
+template <typename T>
+void Track<T>::set_keys(const std::vector<float>& times, const std::vector<T>& values, Interpolation interpolation)
+{
+	this->times = times;
+	this->values = values;
+	this->interpolation = interpolation;
+	in_tangents.clear();
+	out_tangents.clear();
+	if (interpolation == Interpolation::Cubic) {
+		// no tangents given: flat
+		in_tangents.assign(values.size(), values.empty() ? T() : values[0] * 0.0f);
+		out_tangents = in_tangents;
+	}
+}
+
+template <typename T>
+void Track<T>::set_keys(const std::vector<float>& times, const std::vector<T>& values, const std::vector<T>& in_tangents, const std::vector<T>& out_tangents)
+{
+	this->times = times;
+	this->values = values;
+	this->in_tangents = in_tangents;
+	this->out_tangents = out_tangents;
+	interpolation = Interpolation::Cubic;
+}
+
+template <typename T>
+unsigned int Track<T>::size() const
+{
+	return (unsigned int)times.size();
+}
+
+template <typename T>
+float Track<T>::get_start_time() const
+{
+	return times.empty() ? 0.0f : times.front();
+}
+
+template <typename T>
+float Track<T>::get_end_time() const
+{
+	return times.empty() ? 0.0f : times.back();
+}
+
+template <typename T>
+Interpolation Track<T>::get_interpolation() const
+{
+	return interpolation;
+}
+
+template <typename T>
+const std::vector<float>& Track<T>::get_times() const
+{
+	return times;
+}
+
+template <typename T>
+const std::vector<T>& Track<T>::get_values() const
+{
+	return values;
+}
+
+template <typename T>
+const std::vector<T>& Track<T>::get_in_tangents() const
+{
+	return in_tangents;
+}
+
+template <typename T>
+const std::vector<T>& Track<T>::get_out_tangents() const
+{
+	return out_tangents;
+}
+
+template <typename T>
+T Track<T>::sample(float time, unsigned int& cursor) const
+{
+	unsigned int num_keys = (unsigned int)times.size();
+	if (num_keys == 0) {
+		return T();
+	}
+	if (num_keys == 1 || time <= times[0]) {
+		return values[0];
+	}
+	if (time >= times[num_keys - 1]) {
+		return values[num_keys - 1];
+	}
+
+	unsigned int k = find_key(times, time, cursor);
+	float delta_time = times[k + 1] - times[k];
+	float t = delta_time > 0.0f ? (time - times[k]) / delta_time : 0.0f;
+
+	switch (interpolation) {
+	case Interpolation::Constant:
+		return values[k];
+	case Interpolation::Cubic:
+		return hermite(t, values[k], out_tangents[k] * delta_time, values[k + 1], in_tangents[k + 1] * delta_time);
+	default:
+		return interpolate(values[k], values[k + 1], t);
+	}
+}
+
+template <typename T>
+T Track<T>::sample(float time) const
+{
+	unsigned int cursor = 0;
+	return sample(time, cursor);
+}
+
+template class Track<vec3>;
+template class Track<quat>;
\ No newline at end of file
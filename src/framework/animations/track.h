@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "../math/vec3.h"
+#include "../math/quat.h"
+
+// Interpolation between two keyframes (the same as the glTF samplers)
+enum class Interpolation { Constant, Linear, Cubic };
+
+// Linear interpolation of the values of a track (the quaternions take the shortest path)
+vec3 interpolate(const vec3& a, const vec3& b, float t);
+quat interpolate(const quat& a, const quat& b, float t);
+// Get the key k so times[k] <= time < times[k + 1] (time must be inside the keys). The cursor is the key found the previous time:
+// if the time is in the same or the next key it is found in O(1), otherwise (random seek) with a binary search
+unsigned int find_key(const std::vector<float>& times, float time, unsigned int& cursor);
+// Time of a clip played at the given time: wrapped to [start_time, end_time) if it loops, clamped otherwise
+float adjust_time(float time, float start_time, float end_time, bool looping);
+
+// Keyframes of one property (position, rotation or scale) of a joint. The times are stored apart from the values so finding a key is cache friendly
+// Implemented for vec3 and quat
+template <typename T>
+class Track
+{
+protected:
+	std::vector<float> times;
+	std::vector<T> values;
+	std::vector<T> in_tangents;		// only for cubic interpolation (slope per second)
+	std::vector<T> out_tangents;
+	Interpolation interpolation = Interpolation::Linear;
+
+public:
+	Track(); // Empty track
+
+	// Set the keys of the track (the times must be increasing)
+	void set_keys(const std::vector<float>& times, const std::vector<T>& values, Interpolation interpolation = Interpolation::Linear);
+	// Set the keys of a cubic track with the tangents of each key
+	void set_keys(const std::vector<float>& times, const std::vector<T>& values, const std::vector<T>& in_tangents, const std::vector<T>& out_tangents);
+
+	// Number of keys
+	unsigned int size() const;
+	float get_start_time() const;
+	float get_end_time() const;
+	Interpolation get_interpolation() const;
+	const std::vector<float>& get_times() const;
+	const std::vector<T>& get_values() const;
+	const std::vector<T>& get_in_tangents() const;
+	const std::vector<T>& get_out_tangents() const;
+
+	// Get the value at the given time (clamped to the first and last keys). The cursor is the key used by the previous sample (see find_key)
+	T sample(float time, unsigned int& cursor) const;
+	// Get the value at the given time with a binary search
+	T sample(float time) const;
+};
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "application.h"
 
 #include "math/vec3.h"
+#include "job_system.h"
 
 #include "animations/pose.h"
 #include "animations/skeleton.h"
+#include "animations/clip_cache.h"
+#include "graphics/skin_palettes.h"
 
 Camera* Application::camera = nullptr;
 Application* Application::instance;
@@ -33,10 +36,15 @@ void Application::update(float dt)
 {
     float curr_time = glfwGetTime();
 
-    // Update entities of the scene
-    for (unsigned int i = 0; i < entity_list.size(); i++) {
-        entity_list[i]->update(dt);
-    }
+    // Reset the per frame animation stats
+    Pose::num_evaluated_joints = 0;
+    ClipCache::get().new_frame();
+    AnimationLOD::reset_counts();
+
+    // Update entities of the scene: every root entity (with its children) in its own job
+    Entity::update_entities(entity_list, dt);
+    // and then the parts of the update that use the GL context
+    JobSystem::get().process_main_thread_jobs();
 
     // Mouse update
     vec2 delta = last_mouse_position - mouse_position;
@@ -51,6 +59,9 @@ void Application::update(float dt)
 
 void Application::render()
 {
+    // the skin palettes are uploaded again the first time they are used in this frame
+    SkinPalettes::get().new_frame();
+
     // set the clear color (the background color)
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
@@ -18,7 +18,7 @@ Camera::Camera()
 
 vec3 Camera::get_local_vector(const vec3& v)
 {
-	mat4 i_view = inverse(view_matrix);
+	mat4 i_view = inverse_rigid(view_matrix);
 
 	vec4 result = i_view * vec4(v, 0.0f);
 	return vec3(result.x, result.y, result.z);
@@ -99,7 +99,7 @@ void Camera::orbit(float yaw, float pitch)
 	vec3 front = normalized(center - eye);
 	float problem_angle = dot(front, up);
 
-	vec4 right_aux = inverse(view_matrix) * vec4(1.f, 0.f, 0.f, 0.f);
+	vec4 right_aux = inverse_rigid(view_matrix) * vec4(1.f, 0.f, 0.f, 0.f);
 	vec3 right = vec3(right_aux.x, right_aux.y, right_aux.z);
 	vec3 dist = eye - center;
 
@@ -130,7 +130,7 @@ void Camera::move(vec3 delta)
 void Camera::move(vec2 delta)
 {
 	vec3 front = normalized(center - eye) * -1.0f;
-	vec4 right_aux = inverse(view_matrix) * vec4(1.f, 0.f, 0.f, 0.f);
+	vec4 right_aux = inverse_rigid(view_matrix) * vec4(1.f, 0.f, 0.f, 0.f);
 	vec3 right = vec3(right_aux.x, right_aux.y, right_aux.z);
 	vec3 up = normalized(cross(front, right));
 
@@ -1,6 +1,9 @@
 #include "entity.h"
 
 #include "application.h"
+#include "job_system.h"
+#include "math/batch.h"
+#include "animations/baked_palettes.h"
 #include "utils.h"
 
 #include "ImGuizmo.h"
@@ -19,6 +22,7 @@ Entity::Entity(const char* _name)
 	flag_visible = true;
 	flag_update = false;
 	flag_apply_parent_transform = true;
+	flag_main_thread_update = false;
 
 	model = mat4();
 	transform = Transform();
@@ -51,11 +55,7 @@ void Entity::render(Camera* camera)
 
 void Entity::update(float dt)
 {
-	if (children.size() > 0) {
-		for (unsigned int i = 0; i < children.size(); i++) {
-			children[i]->update(dt);			
-		}
-	}
+	update_entities(children, dt);
 }
 
 void Entity::render_gui()
@@ -138,11 +138,30 @@ void Entity::set_children(std::vector<Entity*> entities)
 	children = entities;
 }
 
+void Entity::update_entity(Entity* entity, float dt)
+{
+	if (entity->flag_main_thread_update) {
+		JobSystem::get().run_on_main_thread([entity, dt] { entity->update(dt); });
+	}
+	else {
+		entity->update(dt);
+	}
+}
+
+void Entity::update_entities(const std::vector<Entity*>& entities, float dt)
+{
+	// each entity only writes its own state (and its children's), so the result does not depend on the order of the jobs
+	parallel_for((unsigned int)entities.size(), [&entities, dt](unsigned int i) {
+		update_entity(entities[i], dt);
+	});
+}
+
 LineHelper::LineHelper(vec3 origin, vec3 end, const char* _name) : origin(origin), end(end), Entity(_name)
 {
 	if (!(_name && *_name)) { name = "LineHelper_" + std::to_string(name_id_counter); }
 
 	color = vec4(1.f);
+	flag_main_thread_update = true;
 
 	// create mesh
 	mesh = new Mesh();
@@ -222,25 +241,7 @@ SkeletonHelper::SkeletonHelper(Pose& current_pose, const char* _name) : Entity(_
 	color = vec4(1.f);
 	flag_editable = true;
 	flag_apply_parent_transform = true;
-	
-	for (int i = 0; i < pose->size(); i++) {
-		if (!bones.contains(i)) {
-			Bone bone;
-			bone.name = "Bone_" + std::to_string(i);
-			bones[i] = bone;
-		}
-
-		int parent_id = pose->get_parent(i);
-
-		if (parent_id < 0) continue; // skip joints without parent 		
-
-		if (!bones.contains(parent_id)) {
-			Bone parent;
-			parent.name = "Bone_" + std::to_string(parent_id);
-			bones[parent_id] = parent;
-		}
-		bones[parent_id].children.push_back(i);
-	}
+	flag_main_thread_update = true;
 
 	set_pose(pose);
 }
@@ -251,30 +252,9 @@ SkeletonHelper::SkeletonHelper(Skeleton& skeleton, const char* _name) : Entity(_
 
 	color = vec4(1.f);
 	flag_editable = true;
+	flag_main_thread_update = true;
 
-	std::vector<std::string> names = skeleton.get_joint_names();
-	Pose* pose = &skeleton.get_rest_pose();
-
-	for (int i = 0; i < pose->size(); i++) {
-		if (!bones.contains(i)) {
-			Bone bone;
-			bone.name = names[i];
-			bones[i] = bone;
-		}
-
-		int parent_id = pose->get_parent(i);
-
-		if (parent_id < 0) continue; // skip joints without parent 		
-
-		if (!bones.contains(parent_id)) {
-			Bone parent;
-			parent.name = names[parent_id];
-			bones[parent_id] = parent;
-		}
-		bones[parent_id].children.push_back(i);
-	}
-
-	set_pose(pose);	
+	set_pose(&skeleton.get_rest_pose());
 }
 
 SkeletonHelper::~SkeletonHelper()
@@ -351,16 +331,22 @@ void SkeletonHelper::render_gui()
 	}
 
 	if (ImGui::TreeNode("Skeleton")) {
-		unsigned int root_id = 0;
-		render_gui_bone(root_id, *pose, bones[root_id]);		
+		std::shared_ptr<const Rig> rig = pose->get_rig();
+		for (unsigned int i = 0; i < rig->size(); i++) {
+			if (rig->get_parent(i) < 0) {
+				render_gui_bone(i, *pose, *rig);
+			}
+		}
 
 		ImGui::TreePop();
 	}
 }
 
-void SkeletonHelper::render_gui_bone(unsigned int id, Pose& pose, Bone bone)
+void SkeletonHelper::render_gui_bone(unsigned int id, Pose& pose, const Rig& rig)
 {
-	if (ImGui::TreeNodeEx(bone.name.c_str())) {
+	// joints without a name in the rig are named by id
+	const std::string& name = rig.get_name(id);
+	if (ImGui::TreeNodeEx(name.empty() ? ("Bone_" + std::to_string(id)).c_str() : name.c_str())) {
 
 		ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(ImColor(230, 150, 50)));
 		bool is_open = ImGui::TreeNodeEx("Transform");
@@ -384,9 +370,8 @@ void SkeletonHelper::render_gui_bone(unsigned int id, Pose& pose, Bone bone)
 			ImGui::TreePop();
 		}
 
-		for (unsigned int i = 0; i < bone.children.size(); i++) {
-			Bone child = bones[bone.children[i]];
-			render_gui_bone(bone.children[i], pose, child);
+		for (unsigned int child_id : rig.get_children(id)) {
+			render_gui_bone(child_id, pose, rig);
 		}
 
 		ImGui::TreePop();
@@ -412,9 +397,22 @@ void SkinnedEntity::render(Camera* camera)
 				uniforms.model = model * parent->get_model();
 			}
 			
-			//TODO: TASK5 If it has an skeleton, compute the skin matrices and set the array into the uniform structure (to send it to the GPU).
-			
-			//...
+			// without CPU skinning the vertex shader skins the vertices with the palette (see Material::get_shader): only the palette is
+			// sent, once per frame (see SkinPalettes). The skin matrices are computed once per pose and shared by every mesh skinned with it
+			if (skeleton && !flag_cpu_skinning) {
+				if (skinning_mode == SKINNING_DUAL_QUAT) {
+					uniforms.skin_dual_quats = &get_skin_dual_quats();
+				}
+				else {
+					uniforms.skin_matrices = &get_skin_matrices();
+				}
+				uniforms.skin_version = get_current_pose().get_version();
+			}
+			// the skinned vertices are uploaded right before the draw, so the entities that share the mesh each show their own pose
+			if (mesh && flag_cpu_skinning) {
+				mesh->upload_skinning(this, skinning_changed, skinned_vertices, skinned_normals);
+				skinning_changed = false;
+			}
 			material->render(mesh, uniforms);
 		}
 
@@ -432,24 +430,143 @@ void SkinnedEntity::render(Camera* camera)
 
 void SkinnedEntity::update(float dt)
 {
-	if (children.size() > 0) {
-		for (unsigned int i = 0; i < children.size(); i++) {
-			children[i]->update(dt);
+	// advance the clip and sample it before the meshes of the children use its pose
+	if (clip && skeleton) {
+		clip_time += dt * playback_speed;
+		unsigned int level = 0;
+		if (flag_use_lod && Camera::current) {
+			level = lod.select_level(get_screen_size(*Camera::current));
 		}
-	}
 
-	if (mesh && skeleton) {
-		Pose current_pose = skeleton->get_rest_pose();
-		if (parent && parent->as<SkinnedEntity>()->flag_apply_bind_pose) {
-			current_pose = skeleton->get_bind_pose();
+		if (flag_use_clip_cache && level == 0) {
+			cached_pose = &clip.visit([&](const auto& c) -> ClipCache::Entry& { return ClipCache::get().sample(c, *skeleton, clip_time); });
 		}
+		else {
+			if (cached_pose) {
+				// the cached pose may be gone, start the own pose from a full sample
+				cached_pose = nullptr;
+				clip.sample(animated_pose, clip_time, cursor);
+			}
+			if (flag_use_lod) {
+				lod.sample(clip, clip_time, dt * playback_speed, animated_pose);
+			}
+			else {
+				clip.sample(animated_pose, clip_time, cursor);
+			}
 
-		// TODO: TASK4 Compute CPU Skinning
-		// ..
+			// a frozen pose keeps its version, so neither its skin matrices nor their GPU copy (see SkinPalettes) are updated
+			if (animated_skin_matrices.empty() || animated_skin_version != animated_pose.get_version()) {
+				const std::vector<mat4>& global_matrices = animated_pose.get_global_matrices();
+				const std::vector<mat4>& inv_bind_pose = skeleton->get_inv_bind_pose();
+				unsigned int size = std::min((unsigned int)global_matrices.size(), (unsigned int)inv_bind_pose.size());
+				animated_skin_matrices.resize(size);
+				multiply(global_matrices.data(), inv_bind_pose.data(), animated_skin_matrices.data(), size);
+				animated_skin_version = animated_pose.get_version();
+			}
+		}
+	}
 
+	// the palette of the pose of the children is computed once, before their meshes skin with it in parallel
+	if (skeleton && !children.empty()) {
+		if (flag_apply_bind_pose) {
+			skeleton->get_skin_matrices(skeleton->get_bind_pose());
+		}
+		else {
+			get_skin_matrices();
+		}
+	}
+	// the dual quaternions are only built by the entity that holds the meshes, and read by all of them (see get_skin_dual_quats)
+	SkinnedEntity* owner = parent ? parent->as<SkinnedEntity>() : nullptr;
+	if (skeleton && skinning_mode == SKINNING_DUAL_QUAT && !owner) {
+		Pose& pose = flag_apply_bind_pose && !children.empty() ? skeleton->get_bind_pose() : get_current_pose();
+		if (skin_dual_quats.empty() || skin_dual_quats_version != pose.get_version()) {
+			skeleton->get_dual_quat_palette(pose, skin_dual_quats);
+			skin_dual_quats_version = pose.get_version();
+		}
+	}
+	update_entities(children, dt);
+
+	if (mesh && skeleton && flag_cpu_skinning) {
+		if (skinning_mode == SKINNING_DUAL_QUAT) {
+			mesh->cpu_skinning(get_skin_dual_quats(), skinned_vertices, skinned_normals);
+		}
+		else {
+			mesh->cpu_skinning(get_skin_matrices(), skinned_vertices, skinned_normals);
+		}
+		skinning_changed = true;
 	}
 	if (skeleton_helper) {
-		skeleton_helper->update(dt);
+		update_entity(skeleton_helper, dt);
+	}
+}
+
+Pose& SkinnedEntity::get_current_pose()
+{
+	SkinnedEntity* owner = parent ? parent->as<SkinnedEntity>() : nullptr;
+	if (owner && owner->flag_apply_bind_pose) {
+		return skeleton->get_bind_pose();
+	}
+
+	// the meshes play the clip of the entity that holds them
+	SkinnedEntity* player = owner && owner->clip ? owner : this;
+	if (player->clip) {
+		return player->cached_pose ? player->cached_pose->pose : player->animated_pose;
+	}
+	return skeleton->get_rest_pose();
+}
+
+const std::vector<mat4>& SkinnedEntity::get_skin_matrices()
+{
+	SkinnedEntity* owner = parent ? parent->as<SkinnedEntity>() : nullptr;
+	SkinnedEntity* player = owner && owner->clip ? owner : this;
+	if (player->clip && !(owner && owner->flag_apply_bind_pose)) {
+		return player->cached_pose ? player->cached_pose->skin_matrices : player->animated_skin_matrices;
+	}
+	return skeleton->get_skin_matrices(get_current_pose());
+}
+
+const std::vector<dual_quat>& SkinnedEntity::get_skin_dual_quats()
+{
+	SkinnedEntity* owner = parent ? parent->as<SkinnedEntity>() : nullptr;
+	return owner ? owner->skin_dual_quats : skin_dual_quats;
+}
+
+float SkinnedEntity::get_screen_size(const Camera& camera)
+{
+	mat4 world_model = model;
+	if (parent && flag_apply_parent_transform) {
+		world_model = model * parent->get_model();
+	}
+
+	float screen_size = 0.0f;
+	auto add_mesh = [&](const Mesh* mesh, const mat4& mesh_model) {
+		if (!mesh) {
+			return;
+		}
+		// the radius of the mesh is around its origin, scaled by the largest axis of the model
+		float scale = std::max(len(transform_vector(mesh_model, vec3(1.0f, 0.0f, 0.0f))), std::max(len(transform_vector(mesh_model, vec3(0.0f, 1.0f, 0.0f))), len(transform_vector(mesh_model, vec3(0.0f, 0.0f, 1.0f)))));
+		vec3 center = transform_point(mesh_model, vec3(0.0f, 0.0f, 0.0f));
+		screen_size = std::max(screen_size, AnimationLOD::get_screen_size(camera, center, mesh->radius * scale));
+	};
+
+	add_mesh(mesh, world_model);
+	for (unsigned int i = 0; i < children.size(); i++) {
+		Entity* child = children[i];
+		add_mesh(child->mesh, child->flag_apply_parent_transform ? child->get_model() * world_model : child->get_model());
+	}
+	return screen_size;
+}
+
+void SkinnedEntity::set_clip(ClipHandle clip)
+{
+	this->clip = clip;
+	clip_time = clip ? clip.get_start_time() : 0.0f;
+	cached_pose = nullptr;
+	cursor = ClipCursor();
+	animated_skin_matrices.clear();
+	if (clip && skeleton) {
+		animated_pose = skeleton->get_rest_pose();
+		clip.sample(animated_pose, clip_time, cursor);
 	}
 }
 
@@ -473,6 +590,45 @@ void SkinnedEntity::render_gui()
 			}
 		}
 
+		if (ImGui::Checkbox("CPU skinning", &flag_cpu_skinning)) {
+			for (unsigned int i = 0; i < children.size(); i++) {
+				SkinnedEntity* child = children[i]->as<SkinnedEntity>();
+				if (!child) {
+					continue;
+				}
+				child->flag_cpu_skinning = flag_cpu_skinning;
+				if (!flag_cpu_skinning && child->mesh) {
+					child->mesh->reset_skinning();
+				}
+			}
+		}
+
+		int mode = (int)skinning_mode;
+		if (ImGui::Combo("Skinning", &mode, "Linear blend\0Dual quaternion\0")) {
+			skinning_mode = (SkinningMode)mode;
+			for (unsigned int i = 0; i < children.size(); i++) {
+				SkinnedEntity* child = children[i]->as<SkinnedEntity>();
+				if (child) {
+					child->skinning_mode = skinning_mode;
+				}
+			}
+		}
+
+		if (clip) {
+			ImGui::Text("Clip: %s (%.2f / %.2f s)", clip.get_name().c_str(), clip.adjust_time(clip_time), clip.get_duration());
+			ImGui::DragFloat("Playback speed", &playback_speed, 0.01f, -4.f, 4.f);
+			ImGui::Checkbox("Use animation LOD", &flag_use_lod);
+			if (flag_use_lod) {
+				ImGui::Text("Animation LOD: %u", lod.get_level());
+			}
+			if (ImGui::Checkbox("Use clip cache", &flag_use_clip_cache) && !flag_use_clip_cache) {
+				// sample into the own pose from now on
+				cached_pose = nullptr;
+				animated_pose = skeleton->get_rest_pose();
+				clip.sample(animated_pose, clip_time, cursor);
+			}
+		}
+
 		skeleton_helper->flag_apply_parent_transform = flag_apply_parent_transform;
 		if (ImGui::TreeNode(skeleton_helper->name.c_str())) {
 			skeleton_helper->render_gui();
@@ -484,6 +640,8 @@ void SkinnedEntity::render_gui()
 void SkinnedEntity::set_skeleton(const Pose& rest, const Pose& bind, const std::vector<std::string>& names)
 {
 	skeleton = new Skeleton(rest, bind, names);
+	animated_skin_matrices.clear();
+	skin_dual_quats.clear();
 	skeleton_helper = new SkeletonHelper(*skeleton, (name + "_helper").c_str());
 	skeleton_helper->parent = this;
 
@@ -495,10 +653,76 @@ void SkinnedEntity::set_skeleton(const Pose& rest, const Pose& bind, const std::
 void SkinnedEntity::set_skeleton(Skeleton* skeleton)
 {
 	this->skeleton = skeleton;
+	animated_skin_matrices.clear();
+	skin_dual_quats.clear();
 	skeleton_helper = new SkeletonHelper(*skeleton, (name + "_helper").c_str());
 	skeleton_helper->parent = this;
 
 	for (unsigned int i = 0; i < children.size(); i++) {
 		children[i]->as<SkinnedEntity>()->skeleton = skeleton;
 	}
-}
\ No newline at end of file
+}
+CrowdEntity::CrowdEntity(Mesh* mesh, const BakedPalettes* palettes, const char* _name) : Entity(_name), crowd_material(palettes)
+{
+	if (!(_name && *_name)) { name = "CrowdEntity_" + std::to_string(name_id_counter); }
+
+	this->mesh = mesh;
+	material = &crowd_material;
+	set_grid(1, 1, 0.0f);
+}
+
+void CrowdEntity::render(Camera* camera)
+{
+	if (flag_visible) {
+		mat4 world_model = model;
+		if (parent && flag_apply_parent_transform) {
+			world_model = model * parent->get_model();
+		}
+
+		crowd_material.instance_models.resize(instance_offsets.size());
+		for (unsigned int i = 0; i < instance_offsets.size(); i++) {
+			crowd_material.instance_models[i] = instance_offsets[i] * world_model;
+		}
+
+		Uniforms uniforms;
+		uniforms.camera = camera;
+		uniforms.model = world_model;
+		crowd_material.render(mesh, uniforms);
+	}
+	for (unsigned int i = 0; i < children.size(); i++) {
+		children[i]->render(camera);
+	}
+}
+
+void CrowdEntity::update(float dt)
+{
+	// the instances play the clip from the time of the material, each one some frames later (see BakedSkinningMaterial)
+	crowd_material.time += dt * playback_speed;
+	update_entities(children, dt);
+}
+
+void CrowdEntity::render_gui()
+{
+	Entity::render_gui();
+
+	ImGui::DragFloat("Playback speed", &playback_speed, 0.01f, -4.f, 4.f);
+	ImGui::Text("Instances: %u", (unsigned int)instance_offsets.size());
+}
+
+void CrowdEntity::set_clip(unsigned int clip_id)
+{
+	crowd_material.clip_id = clip_id;
+	const BakedPalettes* palettes = crowd_material.palettes;
+	crowd_material.time = palettes && clip_id < palettes->get_num_clips() ? palettes->get_clip(clip_id).start_time : 0.0f;
+}
+
+void CrowdEntity::set_grid(unsigned int rows, unsigned int columns, float spacing)
+{
+	instance_offsets.resize(rows * columns);
+	for (unsigned int r = 0; r < rows; r++) {
+		for (unsigned int c = 0; c < columns; c++) {
+			vec3 offset((c - (columns - 1) * 0.5f) * spacing, 0.0f, (r - (rows - 1) * 0.5f) * spacing);
+			instance_offsets[r * columns + c] = transform_to_mat4(Transform(offset, quat(), vec3(1.0f, 1.0f, 1.0f)));
+		}
+	}
+}
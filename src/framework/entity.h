@@ -12,6 +12,9 @@
 
 #include "animations/pose.h"
 #include "animations/skeleton.h"
+#include "animations/clip_handle.h"
+#include "animations/clip_cache.h"
+#include "animations/animation_lod.h"
 
 class Entity
 {
@@ -28,6 +31,7 @@ public:
 	bool flag_visible;
 	bool flag_update;
 	bool flag_apply_parent_transform;
+	bool flag_main_thread_update; // the update uses the GL context (e.g. uploads a mesh), so it cannot run in a job
 
 	template <typename ChildEntity>
 	ChildEntity* as() {
@@ -52,6 +56,11 @@ public:
 	void set_model(const mat4& m);
 	void set_transform(const Transform& t);
 	void set_children(std::vector<Entity*> children);
+
+	// Update the entity in the calling thread, or queue it for the main thread if its update uses the GL context
+	static void update_entity(Entity* entity, float dt);
+	// Update the entities in parallel (each one with its children), see update_entity. The entities must not modify each other
+	static void update_entities(const std::vector<Entity*>& entities, float dt);
 };
 
 class LineHelper : public Entity
@@ -78,14 +87,7 @@ public:
 	vec4 color;
 	bool flag_editable;
 
-	struct Bone {
-		std::string name;
-		std::vector<unsigned int> children;
-	};
-
-	std::map<unsigned int, Bone> bones;
-
-	Pose* pose = nullptr;
+	Pose* pose = nullptr; // the hierarchy and the names of the bones come from its rig (bones without a name are shown by id)
 
 	SkeletonHelper(Pose& pose, const char* _name = nullptr);
 	SkeletonHelper(Skeleton& skeleton, const char* _name = nullptr);
@@ -96,7 +98,7 @@ public:
 	void render_gui();
 
 	void set_pose(Pose* pose, bool editable = true);
-	void render_gui_bone(unsigned int id, Pose& pose, Bone bone);
+	void render_gui_bone(unsigned int id, Pose& pose, const Rig& rig);
 };
 
 class SkinnedEntity : public Entity
@@ -106,9 +108,32 @@ public:
 
 	SkeletonHelper* skeleton_helper = nullptr;
 	bool flag_apply_bind_pose;
+	bool flag_cpu_skinning = false; // skin the mesh on the CPU every update (see Mesh::cpu_skinning) instead of in the vertex shader
+	std::vector<vec3> skinned_vertices;	// result of the CPU skinning, uploaded to the mesh when the entity is rendered
+	std::vector<vec3> skinned_normals;
+	bool skinning_changed = false;		// skinned since the last upload
+	SkinningMode skinning_mode = SKINNING_LINEAR;
+	// dual quaternions of the pose of the meshes (dual quaternion skinning only), built by the entity that holds them (see get_skin_dual_quats)
+	std::vector<dual_quat> skin_dual_quats;
+	uint64_t skin_dual_quats_version = 0;		// version of the pose they were built for
 
 	std::vector<mat4> pose_mat_joint_space;
 
+	// clip played by the entity (the meshes of its children play it too), of any clip type
+	ClipHandle clip;
+	float clip_time = 0.0f;
+	float playback_speed = 1.0f;
+	// share the pose with the entities playing the same clip at the same quantized time (see ClipCache)
+	bool flag_use_clip_cache = true;
+	Pose animated_pose;								// pose of the clip when it is not cached
+	ClipCursor cursor;								// keys of the last sample of the animated pose
+	std::vector<mat4> animated_skin_matrices;		// skin matrices of the animated pose (the cached poses have their own)
+	uint64_t animated_skin_version = 0;				// version of the animated pose they were built for (kept while it is frozen)
+	ClipCache::Entry* cached_pose = nullptr;		// pose of the clip when it is cached, valid until the next frame
+	// sample the clip less often and with fewer joints the smaller the entity is on screen (only the LOD 0 uses the clip cache)
+	bool flag_use_lod = true;
+	AnimationLOD lod;
+
 	SkinnedEntity(const char* _name = nullptr);
 
 	void render(Camera* camera);
@@ -117,4 +142,36 @@ public:
 
 	void set_skeleton(const Pose& rest, const Pose& bind, const std::vector<std::string>& names);
 	void set_skeleton(Skeleton* skeleton);
-};
\ No newline at end of file
+	// Play the clip from the start (nullptr to stop it). It can be a Clip, a CompressedClip or a BakedClip
+	void set_clip(ClipHandle clip);
+
+	// Pose to skin the mesh with: the bind pose if the parent shows it, the pose of the clip if any plays, the rest pose otherwise
+	Pose& get_current_pose();
+	// Skin matrices of the current pose (shared with the other entities that use the same pose)
+	const std::vector<mat4>& get_skin_matrices();
+	// Dual quaternions of the current pose, shared with the other meshes of the entity that holds them
+	const std::vector<dual_quat>& get_skin_dual_quats();
+	// Fraction of the screen height covered by the bounding spheres of the meshes of the entity and its children
+	float get_screen_size(const Camera& camera);
+};
+
+// Crowd of instances of a skinned mesh playing a clip of baked palettes, rendered in one draw call (see BakedSkinningMaterial)
+// The entity advances the playback time of the material, and places the instances on a grid around its model
+class CrowdEntity : public Entity
+{
+public:
+	BakedSkinningMaterial crowd_material; // the material of the entity
+	float playback_speed = 1.0f;
+	std::vector<mat4> instance_offsets;	// model of each instance relative to the entity
+
+	CrowdEntity(Mesh* mesh, const BakedPalettes* palettes, const char* _name = nullptr);
+
+	void render(Camera* camera);
+	void update(float dt);
+	void render_gui();
+
+	// Play the clip of the palettes from the start
+	void set_clip(unsigned int clip_id);
+	// Place the instances on a grid of rows x columns with the given distance between them, centered on the entity
+	void set_grid(unsigned int rows, unsigned int columns, float spacing);
+};
@@ -0,0 +1,84 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+
+FrameArena& FrameArena::get()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+FrameArena::FrameArena(size_t capacity)
+{
+	this->capacity = capacity;
+	buffer = static_cast<unsigned char*>(::operator new(capacity, std::align_val_t(alignof(std::max_align_t))));
+}
+
+FrameArena::~FrameArena()
+{
+	reset();
+	::operator delete(buffer, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	// reserve enough bytes to align the start inside the reserved range
+	size_t reserved = bytes + alignment - 1;
+	size_t start = offset.fetch_add(reserved);
+	if (start + reserved <= capacity) {
+		uintptr_t address = reinterpret_cast<uintptr_t>(buffer + start);
+		address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		return reinterpret_cast<void*>(address);
+	}
+
+	// it does not fit: use the heap until the next reset
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	void* block = ::operator new(bytes, std::align_val_t(alignment));
+	std::lock_guard<std::mutex> lock(overflow_mutex);
+	overflow_blocks.push_back({ block, alignment });
+	return block;
+}
+
+void FrameArena::reset()
+{
+	size_t used = offset.load();
+	last_frame_bytes = used;
+	peak_bytes = std::max(peak_bytes, used);
+
+	{
+		std::lock_guard<std::mutex> lock(overflow_mutex);
+		for (const OverflowBlock& block : overflow_blocks) {
+			::operator delete(block.data, std::align_val_t(block.alignment));
+		}
+		overflow_blocks.clear();
+	}
+
+	// the frame did not fit: grow to its size (with some margin) so the next ones do not need the heap
+	if (used > capacity) {
+		::operator delete(buffer, std::align_val_t(alignof(std::max_align_t)));
+		capacity = used + used / 2;
+		buffer = static_cast<unsigned char*>(::operator new(capacity, std::align_val_t(alignof(std::max_align_t))));
+	}
+
+	offset = 0;
+}
+
+size_t FrameArena::get_used() const
+{
+	return offset.load();
+}
+
+size_t FrameArena::get_last_frame_bytes() const
+{
+	return last_frame_bytes;
+}
+
+size_t FrameArena::get_peak_bytes() const
+{
+	return peak_bytes;
+}
+
+size_t FrameArena::get_capacity() const
+{
+	return capacity;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for the temporaries of a frame. Allocating only bumps an offset (atomically, so jobs can allocate in parallel)
+// and everything is freed at once by reset() at the end of the frame (see main_loop). If a frame needs more than the capacity,
+// the rest is served by the heap and the arena grows to that size on the next reset, so it settles at the peak of the application
+class FrameArena
+{
+protected:
+	unsigned char* buffer = nullptr;
+	size_t capacity = 0;
+	std::atomic<size_t> offset = 0;		// bytes requested this frame (also the ones served by the heap)
+
+	struct OverflowBlock
+	{
+		void* data = nullptr;
+		size_t alignment = 0;	// the block is freed with the alignment it was allocated with
+	};
+	std::mutex overflow_mutex;
+	std::vector<OverflowBlock> overflow_blocks;	// heap allocations of the frame that did not fit
+
+	size_t last_frame_bytes = 0;
+	size_t peak_bytes = 0;
+
+public:
+	// Arena of the application, reset once per frame
+	static FrameArena& get();
+
+	FrameArena(size_t capacity = 1 << 20);
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Get memory valid until the next reset (alignment must be a power of two)
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	// Get an array of count default-initialized elements, valid until the next reset (no destructor is ever called)
+	template <typename T>
+	std::span<T> allocate_array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "frame arena elements are never destroyed");
+		T* data = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+		for (size_t i = 0; i < count; i++) {
+			new (data + i) T();
+		}
+		return std::span<T>(data, count);
+	}
+
+	// Free everything allocated since the last reset, growing the arena if the frame did not fit
+	void reset();
+
+	size_t get_used() const;				// bytes allocated since the last reset
+	size_t get_last_frame_bytes() const;	// bytes allocated during the last frame
+	size_t get_peak_bytes() const;			// largest frame so far
+	size_t get_capacity() const;
+};
+
+// STL allocator over the frame arena, for temporary containers: frame_vector<mat4> palette(num_joints);
+// Freeing does nothing, the memory is released by the next reset
+template <typename T>
+struct FrameAllocator
+{
+	typedef T value_type;
+
+	FrameAllocator() = default;
+	template <typename U> FrameAllocator(const FrameAllocator<U>&) { }
+
+	T* allocate(size_t n) { return static_cast<T*>(FrameArena::get().allocate(n * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) { }
+
+	template <typename U> bool operator==(const FrameAllocator<U>&) const { return true; }
+	template <typename U> bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using frame_vector = std::vector<T, FrameAllocator<T>>;
\ No newline at end of file
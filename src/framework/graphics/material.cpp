@@ -7,6 +7,22 @@
 #include <algorithm>
 
 #include "../math/vec3.h"
+#include "../animations/baked_palettes.h"
+#include "skin_palettes.h"
+
+Shader* Material::get_shader(Mesh* mesh, const Uniforms& uniforms)
+{
+	if (!shader || !mesh || mesh->bones.empty() || mesh->weights.empty()) {
+		return shader;
+	}
+	if (uniforms.skin_dual_quats && uniforms.skin_dual_quats->size()) {
+		return shader->get_variant(DUAL_QUAT_SKINNING_MACROS);
+	}
+	if (uniforms.skin_matrices && uniforms.skin_matrices->size()) {
+		return shader->get_variant(SKINNING_MACROS);
+	}
+	return shader;
+}
 
 FlatMaterial::FlatMaterial(vec4 color)
 {
@@ -18,18 +34,27 @@ FlatMaterial::~FlatMaterial() { }
 
 void FlatMaterial::set_uniforms(Uniforms& uniforms)
 {
+	// the enabled shader may be a variant of shader (see get_shader)
+	Shader* shader = Shader::current;
+
 	//upload node uniforms
 	shader->set_uniform("u_viewprojection", uniforms.camera->viewprojection_matrix);
 	shader->set_uniform("u_camera_position", uniforms.camera->eye);
 	shader->set_uniform("u_model", uniforms.model);
-	if (uniforms.skin_matrices.size()) {
-		shader->set_uniform("u_skin_matrices", uniforms.skin_matrices);
+	// the palettes are uploaded once per frame and bound to every mesh skinned with them: 4 texels per matrix (the columns), and 2 per
+	// dual quaternion (the real and the dual parts)
+	if (uniforms.skin_matrices && uniforms.skin_matrices->size()) {
+		SkinPalettes::get().bind(shader, "u_skin_matrices", uniforms.skin_matrices->data()->data, (unsigned int)uniforms.skin_matrices->size() * 4, uniforms.skin_version);
+	}
+	if (uniforms.skin_dual_quats && uniforms.skin_dual_quats->size()) {
+		SkinPalettes::get().bind(shader, "u_skin_dual_quats", uniforms.skin_dual_quats->data()->real.v, (unsigned int)uniforms.skin_dual_quats->size() * 2, uniforms.skin_version);
 	}
 	shader->set_uniform("u_color", color);
 }
 
 void FlatMaterial::render(Mesh* mesh, Uniforms& uniforms)
 {
+	Shader* shader = get_shader(mesh, uniforms);
 	if (mesh && shader) {
 		// enable shader
 		shader->enable();
@@ -66,13 +91,19 @@ PBRMaterial::PBRMaterial()
 
 void PBRMaterial::set_uniforms(Uniforms& uniforms)
 {
+	// the enabled shader may be a variant of shader (see get_shader)
+	Shader* shader = Shader::current;
+
 	//upload node uniforms
 	shader->set_uniform("u_viewprojection", uniforms.camera->viewprojection_matrix);
 	shader->set_uniform("u_camera_position", uniforms.camera->eye);
 	shader->set_uniform("u_model", uniforms.model);
 
-	if (uniforms.skin_matrices.size()) {
-		shader->set_uniform("u_skin_matrices", uniforms.skin_matrices);
+	if (uniforms.skin_matrices && uniforms.skin_matrices->size()) {
+		SkinPalettes::get().bind(shader, "u_skin_matrices", uniforms.skin_matrices->data()->data, (unsigned int)uniforms.skin_matrices->size() * 4, uniforms.skin_version);
+	}
+	if (uniforms.skin_dual_quats && uniforms.skin_dual_quats->size()) {
+		SkinPalettes::get().bind(shader, "u_skin_dual_quats", uniforms.skin_dual_quats->data()->real.v, (unsigned int)uniforms.skin_dual_quats->size() * 2, uniforms.skin_version);
 	}
 
 	if (albedo_tex) shader->set_uniform("u_texture", albedo_tex, 0);
@@ -93,6 +124,7 @@ WireframeMaterial::~WireframeMaterial() { }
 
 void WireframeMaterial::render(Mesh* mesh, Uniforms& uniforms)
 {
+	Shader* shader = get_shader(mesh, uniforms);
 	if (shader && mesh)
 	{
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -110,4 +142,91 @@ void WireframeMaterial::render(Mesh* mesh, Uniforms& uniforms)
 		glEnable(GL_CULL_FACE);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	}
+}
+
+BakedSkinningMaterial::BakedSkinningMaterial(const BakedPalettes* palettes)
+{
+	shader = Shader::get("res/shaders/baked_skinning.vs", "res/shaders/flat.fs");
+	set_palettes(palettes);
+}
+
+BakedSkinningMaterial::~BakedSkinningMaterial()
+{
+	if (palette_texture) {
+		delete palette_texture;
+	}
+}
+
+void BakedSkinningMaterial::set_palettes(const BakedPalettes* palettes)
+{
+	this->palettes = palettes;
+	if (!palettes || !palettes->get_num_frames()) {
+		return;
+	}
+
+	// GL 3.3 only guarantees 1024 texels per side: 341 joints or about 34 seconds of clips at 30 fps
+	int max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (palettes->get_width() > (unsigned int)max_size || palettes->get_num_frames() > (unsigned int)max_size) {
+		std::cout << "[Warning] BakedSkinningMaterial: the palettes (" << palettes->get_width() << "x" << palettes->get_num_frames()
+			<< " texels) exceed the maximum texture size " << max_size << ", bake fewer or shorter clips" << std::endl;
+		// the texture of the previous palettes would not match them
+		delete palette_texture;
+		palette_texture = nullptr;
+		return;
+	}
+
+	// the data is only read with texelFetch, so there are no mipmaps
+	if (!palette_texture) {
+		palette_texture = new Texture();
+	}
+	palette_texture->create(palettes->get_width(), palettes->get_num_frames(), GL_RGBA, GL_FLOAT, false, (uint8_t*)palettes->get_data(), GL_RGBA32F);
+}
+
+void BakedSkinningMaterial::set_uniforms(Uniforms& uniforms)
+{
+	shader->set_uniform("u_viewprojection", uniforms.camera->viewprojection_matrix);
+	shader->set_uniform("u_camera_position", uniforms.camera->eye);
+	shader->set_uniform("u_color", color);
+
+	const BakedPaletteClip& clip = palettes->get_clip(clip_id);
+	shader->set_uniform("u_palette_texture", palette_texture, 0);
+	shader->set_uniform("u_palette_first_frame", (int)clip.first_frame);
+	shader->set_uniform("u_palette_num_frames", (int)clip.num_frames);
+	shader->set_uniform("u_palette_looping", (int)clip.looping);
+	shader->set_uniform("u_palette_frame", (int)palettes->get_frame(clip_id, time));
+	shader->set_uniform("u_palette_instance_offset", instance_frame_offset);
+}
+
+void BakedSkinningMaterial::render(Mesh* mesh, Uniforms& uniforms)
+{
+	if (mesh && shader && palettes && palette_texture && clip_id < palettes->get_num_clips()) {
+		shader->enable();
+		set_uniforms(uniforms);
+
+		// the models of the instances are vertex attributes
+		if (instance_models.size()) {
+			mesh->render_instanced(GL_TRIANGLES, instance_models.data(), (int)instance_models.size());
+		}
+		else {
+			mesh->render_instanced(GL_TRIANGLES, &uniforms.model, 1);
+		}
+
+		shader->disable();
+	}
+}
+
+void BakedSkinningMaterial::render_gui()
+{
+	FlatMaterial::render_gui();
+	if (palettes) {
+		ImGui::Text("Baked palettes: %u clips, %u frames, %.1f KB", palettes->get_num_clips(), palettes->get_num_frames(), palettes->get_bytes() / 1024.f);
+		int clip = (int)clip_id;
+		if (ImGui::SliderInt("Clip", &clip, 0, (int)palettes->get_num_clips() - 1)) {
+			clip_id = (unsigned int)clip;
+		}
+	}
+	ImGui::DragFloat("Time", &time, 0.01f);
+	ImGui::DragInt("Instance frame offset", &instance_frame_offset, 1.f, 0, 100);
+	ImGui::Text("Instances: %u", std::max(1u, (unsigned int)instance_models.size()));
 }
\ No newline at end of file
@@ -7,11 +7,22 @@
 
 #include "../math/vec4.h"
 #include "../math/mat4.h"
+#include "../math/dual_quat.h"
+
+// macros of the variants of the vertex shader that skin the vertices with u_skin_matrices or u_skin_dual_quats (see Material::get_shader)
+#define SKINNING_MACROS "#define SKINNING\n"
+#define DUAL_QUAT_SKINNING_MACROS "#define DUAL_QUAT_SKINNING\n"
+
+class BakedPalettes;
 
 struct Uniforms {
 	mat4 model;
 	Camera* camera = nullptr;
-	std::vector<mat4> skin_matrices;
+	// palette to skin the vertices with in the vertex shader (one of them): the skin matrices are shared by every mesh of the
+	// skeleton (see Skeleton::get_skin_matrices)
+	const std::vector<mat4>* skin_matrices = nullptr;
+	const std::vector<dual_quat>* skin_dual_quats = nullptr;
+	uint64_t skin_version = 0; // version of the pose of the palette (see SkinPalettes)
 };
 
 class Material {
@@ -24,6 +35,10 @@ public:
 	virtual void set_uniforms(Uniforms& uniforms) = 0;
 	virtual void render(Mesh* mesh, Uniforms& uniforms) = 0;
 	virtual void render_gui() = 0;
+
+	// Shader to render the mesh with the uniforms: the variant of shader that skins the vertices if the mesh has bones and weights and
+	// the uniforms a palette, shader otherwise
+	Shader* get_shader(Mesh* mesh, const Uniforms& uniforms);
 };
 
 class FlatMaterial : public Material {
@@ -65,4 +80,28 @@ public:
 	~WireframeMaterial();
 
 	void render(Mesh* mesh, Uniforms& uniforms);
+};
+
+// Renders instances of a skinned mesh playing a clip of a BakedPalettes without any CPU pose work: the vertex shader reads the
+// skin matrices of its frame from a float texture. Each instance plays the clip instance_frame_offset frames after the previous one
+// (clamped to the last frame if the clip does not loop)
+class BakedSkinningMaterial : public FlatMaterial {
+public:
+	const BakedPalettes* palettes = nullptr;
+	Texture* palette_texture = NULL;
+
+	unsigned int clip_id = 0;
+	float time = 0.f;					// playback time of the first instance (advanced by its CrowdEntity)
+	int instance_frame_offset = 7;
+	std::vector<mat4> instance_models;	// world model of every instance (the model of the entity if empty)
+
+	BakedSkinningMaterial(const BakedPalettes* palettes = nullptr);
+	~BakedSkinningMaterial();
+
+	// Upload the skin matrices of the palettes to the palette texture
+	void set_palettes(const BakedPalettes* palettes);
+
+	void set_uniforms(Uniforms& uniforms);
+	void render(Mesh* mesh, Uniforms& uniforms);
+	void render_gui();
 };
\ No newline at end of file
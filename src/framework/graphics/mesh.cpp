@@ -1,5 +1,7 @@
 #include "mesh.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <limits>
@@ -12,6 +14,8 @@
 #include "../camera.h"
 #include "../animations/pose.h"
 #include "../animations/skeleton.h"
+#include "../math/batch.h"
+#include "../job_system.h"
 
 bool Mesh::use_binary = true;			//checks if there is .wbin, it there is one tries to read it instead of the other file
 bool Mesh::auto_upload_to_vram = true;	//uploads the mesh to the GPU VRAM to speed up rendering
@@ -106,17 +110,77 @@ void Mesh::clear()
 	uvs1.clear();
 }
 
-void Mesh::cpu_skinning(Skeleton* skeleton, Pose pose)
+void Mesh::cpu_skinning(Skeleton* skeleton, const PoseView& pose, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals)
 {
-	//TODO: TASK 4 Compute the skinned animated vertices and normals
-	std::vector<vec3> skinned_vertices(vertices.size());
-	std::vector<vec3> skinned_normals(vertices.size());
+	// skeleton->get_skin_matrices(pose) gives the skin matrices of the pose (shared with the GPU skinning of the other meshes)
+	cpu_skinning(skeleton->get_skin_matrices(pose), out_vertices, out_normals);
+}
+
+void Mesh::cpu_skinning(const std::vector<mat4>& skin_matrices, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals)
+{
+	cpu_skinning(skin_matrices.data(), (unsigned int)skin_matrices.size(), out_vertices, out_normals);
+}
+
+void Mesh::cpu_skinning(const std::vector<dual_quat>& dual_quats, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals)
+{
+	cpu_skinning(dual_quats.data(), (unsigned int)dual_quats.size(), out_vertices, out_normals);
+}
+
+template <typename Palette>
+void Mesh::cpu_skinning(const Palette* palette, unsigned int palette_size, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals)
+{
+	unsigned int num_vertices = (unsigned int)vertices.size();
+	if (bones.size() < num_vertices || weights.size() < num_vertices) {
+		return;
+	}
+	const vec3* vertex_normals = normals.size() >= num_vertices ? normals.data() : nullptr;
+
+	// the entities that share the mesh may find the highest bone at once, they all find the same one
+	int max_bone = std::atomic_ref<int>(max_skinned_bone).load(std::memory_order_relaxed);
+	if (max_bone < 0) {
+		for (unsigned int i = 0; i < num_vertices; i++) {
+			max_bone = std::max({ max_bone, bones[i].x, bones[i].y, bones[i].z, bones[i].w });
+		}
+		std::atomic_ref<int>(max_skinned_bone).store(max_bone, std::memory_order_relaxed);
+	}
+	if (max_bone >= (int)palette_size) {
+		if (!std::atomic_ref<bool>(skinning_warned).exchange(true, std::memory_order_relaxed)) {
+			std::cout << "[Warning] Mesh::cpu_skinning: the vertices use the bone " << max_bone << " but the palette has " << palette_size << " bones" << std::endl;
+		}
+		return;
+	}
 
-	// ..
+	// the buffers keep their memory from one frame to the next
+	out_vertices.resize(num_vertices);
+	out_normals.resize(vertex_normals ? num_vertices : 0);
+	vec3* skinned_vertices = out_vertices.data();
+	vec3* skinned_normals = vertex_normals ? out_normals.data() : nullptr;
+	JobSystem::get().parallel_for(num_vertices, [&](unsigned int begin, unsigned int end) {
+		skin(palette, vertices.data() + begin, vertex_normals ? vertex_normals + begin : nullptr, bones.data() + begin,
+			weights.data() + begin, skinned_vertices + begin, skinned_normals ? skinned_normals + begin : nullptr, end - begin);
+	}, 4096);
+}
 
-	// upload the skinned vertices and normals to the GPU (don't overwrite the vertices and the normals of the mesh)
+void Mesh::upload_skinning(const void* source, bool changed, const std::vector<vec3>& skinned_vertices, const std::vector<vec3>& skinned_normals)
+{
+	if (skinned_vertices.empty() || (!changed && skinning_source == source)) {
+		return;
+	}
+	// don't overwrite the vertices and the normals of the mesh
 	upload_attributes_to_vram(skinned_vertices, vertices_vbo_id);
-	upload_attributes_to_vram(skinned_normals, normals_vbo_id);
+	if (skinned_normals.size()) {
+		upload_attributes_to_vram(skinned_normals, normals_vbo_id);
+	}
+	skinning_source = source;
+}
+
+void Mesh::reset_skinning()
+{
+	upload_attributes_to_vram(vertices, vertices_vbo_id);
+	if (normals.size()) {
+		upload_attributes_to_vram(normals, normals_vbo_id);
+	}
+	skinning_source = nullptr;
 }
 
 int vertex_location = -1;
@@ -587,7 +651,7 @@ void Mesh::upload_to_vram()
 }
 
 template<typename T>
-void Mesh::upload_attributes_to_vram(const std::vector<T> values, unsigned int& id)
+void Mesh::upload_attributes_to_vram(const std::vector<T>& values, unsigned int& id)
 {
 	if (id == 0)
 		glGenBuffers(1, &id);
@@ -12,7 +12,8 @@
 class Shader; //for binding
 class Image; //for displace
 class Skeleton; //for skinned meshes
-class Pose;
+class PoseView;
+struct dual_quat;
 
 //version from 21/01/2024
 #define MESH_BIN_VERSION 12 //this is used to regenerate bins if the format changes
@@ -95,6 +96,9 @@ public:
 	std::vector<vec4> weights; //tells how much affect every bone
 	std::vector<BoneInfo> bones_info; //tells 
 	mat4 bind_matrix;
+	int max_skinned_bone = -1; //highest bone of the vertices (found the first time they are skinned)
+	bool skinning_warned = false; //the palette was too small for the bones of the vertices (warned once)
+	const void* skinning_source = nullptr; //owner of the skinned vertices in the vbos (see upload_skinning)
 
 	vec3 aabb_min;
 	vec3 aabb_max;
@@ -119,7 +123,20 @@ public:
 
 	void clear();
 
-	void cpu_skinning(Skeleton* skeleton, Pose pose);
+	void cpu_skinning(Skeleton* skeleton, const PoseView& pose, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals);
+	// Skin the vertices and normals with the skin matrices in parallel jobs into the given buffers (see upload_skinning). Can be called
+	// from any thread, also for a mesh shared by several entities: each one skins into its own buffers, so each one shows its own pose
+	void cpu_skinning(const std::vector<mat4>& skin_matrices, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals);
+	// The same with dual quaternion skinning (see Skeleton::get_dual_quat_palette)
+	void cpu_skinning(const std::vector<dual_quat>& dual_quats, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals);
+	// Skin with a palette of matrices or dual quaternions (the body of both cpu_skinning)
+	template <typename Palette>
+	void cpu_skinning(const Palette* palette, unsigned int palette_size, std::vector<vec3>& out_vertices, std::vector<vec3>& out_normals);
+	// Upload skinned vertices and normals in place of the ones of the mesh (from the main thread, before rendering it). They are
+	// uploaded if they changed or if the vbos hold the ones of another source (e.g. another entity that shares the mesh)
+	void upload_skinning(const void* source, bool changed, const std::vector<vec3>& skinned_vertices, const std::vector<vec3>& skinned_normals);
+	// Upload the vertices and normals of the mesh again in place of the skinned ones (from the main thread)
+	void reset_skinning();
 
 	void render(unsigned int primitive, int submesh_id = -1, int num_instances = 0);
 	void render_instanced(unsigned int primitive, const mat4* instanced_models, int number);
@@ -163,7 +180,7 @@ public:
 	//optimize meshes
 	void upload_to_vram();
 	template <typename T>
-	void upload_attributes_to_vram(const std::vector<T> values, unsigned int& id);
+	void upload_attributes_to_vram(const std::vector<T>& values, unsigned int& id);
 
 	bool interleave_buffers();
 
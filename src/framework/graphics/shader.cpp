@@ -77,6 +77,19 @@ void Shader::set_filenames(const std::string& vsf, const std::string& psf)
 	ps_filename = psf;
 }
 
+// GLSL needs #version before anything else, so the macros go after it
+static std::string add_macros(const std::string& code, const std::string& macros)
+{
+	if (code.compare(0, 8, "#version") != 0) {
+		return macros + "\n" + code;
+	}
+	size_t end = code.find('\n');
+	if (end == std::string::npos) {
+		return code + "\n" + macros + "\n";
+	}
+	return code.substr(0, end + 1) + macros + "\n" + code.substr(end + 1);
+}
+
 bool Shader::load(const std::string& vsf, const std::string& psf, const char* macros)
 {
 	assert(compiled == false);
@@ -97,8 +110,8 @@ bool Shader::load(const std::string& vsf, const std::string& psf, const char* ma
 	//printf("Fragment shader from memory:\n%s\n", psm.c_str());
 	if (macros)
 	{
-		vsm = macros + vsm;
-		psm = macros + psm;
+		vsm = add_macros(vsm, macros);
+		psm = add_macros(psm, macros);
 		this->macros = macros;
 	}
 
@@ -154,6 +167,14 @@ static inline std::string trim(std::string str) {
 	return str;
 }
 
+Shader* Shader::get_variant(const char* macros)
+{
+	if (from_atlas || !vs_filename.size() || !ps_filename.size()) {
+		return this;
+	}
+	return get(vs_filename.c_str(), ps_filename.c_str(), macros);
+}
+
 void Shader::set_macros(const char* macros)
 {
 	this->macros = macros;
@@ -239,8 +260,8 @@ bool Shader::load_atlas(const char* filename)
 			continue;
 		}
 
-		vs_code = macros + "\n" + vs_code;
-		fs_code = macros + "\n" + fs_code;
+		vs_code = add_macros(vs_code, macros);
+		fs_code = add_macros(fs_code, macros);
 
 		Shader* shader = NULL;
 		auto it = s_Shaders.find(name);
@@ -732,11 +753,11 @@ void Shader::set_matrix4(const char* varname, const mat4& m)
 	assert(glGetError() == GL_NO_ERROR);
 }
 
-void Shader::set_matrix4_array(const char* varname, mat4* m_array, int num)
+void Shader::set_matrix4_array(const char* varname, const mat4* m_array, int num)
 {
 	GLint loc = get_location(varname, &locations);
 	CHECK_SHADER_VAR(loc, varname);
-	glUniformMatrix4fv(loc, num, GL_FALSE, (GLfloat*)m_array);
+	glUniformMatrix4fv(loc, num, GL_FALSE, (const GLfloat*)m_array);
 	assert(glGetError() == GL_NO_ERROR);
 }
 
@@ -64,7 +64,7 @@ public:
 	void set_uniform(const char* varname, const vec3& input) { assert(current == this); set_uniform3(varname, input.x, input.y, input.z); }
 	void set_uniform(const char* varname, const vec4& input) { assert(current == this); set_uniform4(varname, input.x, input.y, input.z, input.w); }
 	void set_uniform(const char* varname, const mat4& input) { assert(current == this); set_matrix4(varname, input); }
-	void set_uniform(const char* varname, std::vector<mat4>& m_vector) { assert(current == this && m_vector.size()); set_matrix4_array(varname, &m_vector[0], static_cast<int>(m_vector.size())); }
+	void set_uniform(const char* varname, const std::vector<mat4>& m_vector) { assert(current == this && m_vector.size()); set_matrix4_array(varname, &m_vector[0], static_cast<int>(m_vector.size())); }
 
 	//for textures you must specify an slot (a number from 0 to 16) where this texture is stored in the shader
 	void set_uniform(const char* varname, Texture* texture, int slot) { assert(current == this); set_texture(varname, texture, slot); }
@@ -75,7 +75,7 @@ public:
 	virtual void setVector3(const char* varname, const vec3& input) { set_uniform3(varname, input.x, input.y, input.z); }
 	virtual void set_matrix4(const char* varname, const float* m);
 	virtual void set_matrix4(const char* varname, const mat4& m);
-	virtual void set_matrix4_array(const char* varname, mat4* m_array, int num);
+	virtual void set_matrix4_array(const char* varname, const mat4* m_array, int num);
 
 	virtual void set_uniform1_array(const char* varname, const float* input, const int count);
 	virtual void set_uniform2_array(const char* varname, const float* input, const int count);
@@ -112,6 +112,8 @@ public:
 	bool compiled;
 
 	void set_macros(const char* macros);
+	// The same shader files compiled with other macros (itself if it was not loaded from files)
+	Shader* get_variant(const char* macros);
 
 	static Shader* get(const char* vsf, const char* psf = NULL, const char* macros = NULL);
 	static void reload_all();
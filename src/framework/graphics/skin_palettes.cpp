@@ -0,0 +1,97 @@
+#include "skin_palettes.h"
+
+#include "shader.h"
+#include "../includes.h"
+
+SkinPalettes& SkinPalettes::get()
+{
+	static SkinPalettes palettes;
+	return palettes;
+}
+
+unsigned int SkinPalettes::get_texture(const float* palette, unsigned int num_texels, uint64_t version)
+{
+	Buffer& buffer = buffers[palette];
+	buffer.last_used = current_frame;
+	if (buffer.buffer_id && buffer.version == version && buffer.size == num_texels) {
+		return buffer.texture_id;
+	}
+
+	if (!buffer.buffer_id) {
+		glGenBuffers(1, &buffer.buffer_id);
+		glGenTextures(1, &buffer.texture_id);
+		glBindTexture(GL_TEXTURE_BUFFER, buffer.texture_id);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer.buffer_id);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer.buffer_id);
+	}
+	// new storage every upload, so the draws of the last frame that still read the old one do not stall it
+	unsigned int bytes = num_texels * 4 * sizeof(float);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer.buffer_id);
+	glBufferData(GL_TEXTURE_BUFFER, bytes, palette, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	buffer.size = num_texels;
+	buffer.version = version;
+	frame_uploads++;
+	frame_bytes += bytes;
+	return buffer.texture_id;
+}
+
+void SkinPalettes::bind(Shader* shader, const char* name, const float* palette, unsigned int num_texels, uint64_t version)
+{
+	unsigned int texture_id = get_texture(palette, num_texels, version);
+	glActiveTexture(GL_TEXTURE0 + SKIN_PALETTE_TEXTURE_SLOT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture_id);
+	// the textures of the materials are bound to the unit that is active
+	glActiveTexture(GL_TEXTURE0);
+	shader->set_uniform(name, SKIN_PALETTE_TEXTURE_SLOT);
+}
+
+void SkinPalettes::release(Buffer& buffer)
+{
+	glDeleteTextures(1, &buffer.texture_id);
+	glDeleteBuffers(1, &buffer.buffer_id);
+	buffer = Buffer();
+}
+
+void SkinPalettes::new_frame()
+{
+	last_uploads = frame_uploads;
+	last_bytes = frame_bytes;
+	frame_uploads = 0;
+	frame_bytes = 0;
+	current_frame++;
+
+	// the palettes of the entities that stopped rendering (or were deleted)
+	for (auto it = buffers.begin(); it != buffers.end();) {
+		if (it->second.last_used + 2 < current_frame) {
+			release(it->second);
+			it = buffers.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void SkinPalettes::clear()
+{
+	for (auto& entry : buffers) {
+		release(entry.second);
+	}
+	buffers.clear();
+}
+
+unsigned int SkinPalettes::size() const
+{
+	return (unsigned int)buffers.size();
+}
+
+unsigned int SkinPalettes::get_uploads() const
+{
+	return last_uploads;
+}
+
+unsigned int SkinPalettes::get_bytes() const
+{
+	return last_bytes;
+}
\ No newline at end of file
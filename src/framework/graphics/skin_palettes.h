@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+class Shader;
+
+// texture unit of the skin palettes (the materials use the first ones)
+#define SKIN_PALETTE_TEXTURE_SLOT 7
+
+// GPU copies of the skin palettes (skin matrices or dual quaternions) in texture buffers: a palette is uploaded the first time a mesh
+// skinned with it is rendered after its pose changed, and every other mesh, pass and frame only binds it (e.g. a frozen pose is not
+// uploaded again). The shaders read it with
+// texelFetch (a vec4 per texel), so the number of joints is not limited by the uniforms and does not change the shaders
+// The palettes are identified by the address of their data, which the updates of the entities keep until the next frame, and the
+// version of their pose (a palette shared by several poses, as the one of the skeleton, is uploaded again when the pose changes)
+class SkinPalettes
+{
+protected:
+	struct Buffer
+	{
+		unsigned int buffer_id = 0;
+		unsigned int texture_id = 0;
+		unsigned int size = 0;			// texels
+		uint64_t last_used = 0;			// frame
+		uint64_t version = 0;			// of the pose of the palette
+	};
+
+	std::unordered_map<const void*, Buffer> buffers;
+	uint64_t current_frame = 1;
+	unsigned int frame_uploads = 0;
+	unsigned int frame_bytes = 0;
+	unsigned int last_uploads = 0;
+	unsigned int last_bytes = 0;
+
+	void release(Buffer& buffer);
+
+public:
+	// Palettes of the application, a new frame starts every render. Only for the main thread (it uses the GL context)
+	static SkinPalettes& get();
+
+	// Texture buffer (RGBA32F) with the palette of num_texels vec4 of the pose version, uploaded if the last upload had another version
+	unsigned int get_texture(const float* palette, unsigned int num_texels, uint64_t version);
+	// Bind the texture buffer of the palette to the skin palette texture unit, and the sampler of the enabled shader to it
+	void bind(Shader* shader, const char* name, const float* palette, unsigned int num_texels, uint64_t version);
+
+	// Start a new frame: the palettes not used in the last frames are released
+	void new_frame();
+	void clear();
+
+	unsigned int size() const;
+	// Palettes uploaded in the last frame and their bytes
+	unsigned int get_uploads() const;
+	unsigned int get_bytes() const;
+};
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "job_system.h"
+
+// queue of the calling thread: its own queue for the workers, the shared queue 0 for the rest
+static thread_local JobSystem* worker_job_system = nullptr;
+static thread_local unsigned int worker_queue_index = 0;
+
+JobSystem& JobSystem::get()
+{
+	static JobSystem job_system(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return job_system;
+}
+
+JobSystem::JobSystem(unsigned int num_workers)
+{
+	for (unsigned int i = 0; i < num_workers + 1; i++) {
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (unsigned int i = 0; i < num_workers; i++) {
+		workers.emplace_back(&JobSystem::worker_loop, this, i + 1);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	wake_up.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+unsigned int JobSystem::get_num_workers() const
+{
+	return (unsigned int)workers.size();
+}
+
+unsigned int JobSystem::get_num_threads() const
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+unsigned int JobSystem::get_queue_index() const
+{
+	return worker_job_system == this ? worker_queue_index : 0;
+}
+
+bool JobSystem::pop(unsigned int queue_index, Job& job)
+{
+	WorkQueue& queue = *queues[queue_index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty()) {
+		return false;
+	}
+	job = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	num_queued--;
+	return true;
+}
+
+bool JobSystem::steal(unsigned int queue_index, Job& job)
+{
+	// try the other queues starting from the next one, so the thieves do not all go to the same queue
+	unsigned int num_queues = (unsigned int)queues.size();
+	for (unsigned int i = 1; i < num_queues; i++) {
+		WorkQueue& queue = *queues[(queue_index + i) % num_queues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			num_queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+	job.function();
+	if (job.group) {
+		job.group->on_job_finished();
+	}
+}
+
+void JobSystem::worker_loop(unsigned int queue_index)
+{
+	worker_job_system = this;
+	worker_queue_index = queue_index;
+
+	while (true) {
+		Job job;
+		if (pop(queue_index, job) || steal(queue_index, job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake_up.wait(lock, [this] { return stopping || num_queued > 0; });
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+void JobSystem::submit(Job&& job)
+{
+	WorkQueue& queue = *queues[get_queue_index()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+		num_queued++;
+	}
+	// taking the lock makes sure a worker that is going to sleep sees the job
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+	wake_up.notify_one();
+}
+
+bool JobSystem::run_one()
+{
+	Job job;
+	unsigned int queue_index = get_queue_index();
+	if (pop(queue_index, job) || steal(queue_index, job)) {
+		execute(job);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::parallel_for(unsigned int count, const std::function<void(unsigned int begin, unsigned int end)>& function, unsigned int min_range)
+{
+	if (count == 0) {
+		return;
+	}
+
+	// 4 ranges per thread, unless they would be smaller than min_range
+	unsigned int num_ranges = std::min(get_num_threads() * 4, (count + std::max(min_range, 1u) - 1) / std::max(min_range, 1u));
+	if (num_ranges <= 1) {
+		function(0, count);
+		return;
+	}
+
+	TaskGroup group(*this);
+	unsigned int range_size = (count + num_ranges - 1) / num_ranges;
+	for (unsigned int begin = range_size; begin < count; begin += range_size) {
+		unsigned int end = std::min(begin + range_size, count);
+		group.run([&function, begin, end] { function(begin, end); });
+	}
+	// the calling thread takes the first range
+	function(0, std::min(range_size, count));
+	group.wait();
+}
+
+void JobSystem::run_on_main_thread(std::function<void()> function)
+{
+	std::lock_guard<std::mutex> lock(main_thread_mutex);
+	main_thread_jobs.push_back(std::move(function));
+}
+
+void JobSystem::process_main_thread_jobs()
+{
+	// the functions can queue more functions for the next frame
+	std::vector<std::function<void()>> functions;
+	{
+		std::lock_guard<std::mutex> lock(main_thread_mutex);
+		functions.swap(main_thread_jobs);
+	}
+	for (std::function<void()>& function : functions) {
+		function();
+	}
+}
+
+TaskGroup::TaskGroup(JobSystem& job_system)
+{
+	this->job_system = &job_system;
+}
+
+TaskGroup::~TaskGroup()
+{
+	wait();
+}
+
+void TaskGroup::depends_on(TaskGroup& group)
+{
+	std::lock_guard<std::mutex> group_lock(group.mutex);
+	if (group.pending == 0) {
+		return;
+	}
+	group.dependents.push_back(this);
+	std::lock_guard<std::mutex> lock(mutex);
+	num_blockers++;
+}
+
+void TaskGroup::run(std::function<void()> function)
+{
+	pending++;
+	JobSystem::Job job = { std::move(function), this };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (num_blockers > 0) {
+			held_jobs.push_back(std::move(job));
+			return;
+		}
+	}
+	job_system->submit(std::move(job));
+}
+
+void TaskGroup::on_job_finished()
+{
+	// the lock keeps a new dependency from being added between the last job and the release of the dependents
+	std::vector<TaskGroup*> released;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--pending == 0) {
+			released.swap(dependents);
+		}
+	}
+	for (TaskGroup* group : released) {
+		group->on_dependency_finished();
+	}
+}
+
+void TaskGroup::on_dependency_finished()
+{
+	std::vector<JobSystem::Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--num_blockers > 0) {
+			return;
+		}
+		jobs.swap(held_jobs);
+	}
+	for (JobSystem::Job& job : jobs) {
+		job_system->submit(std::move(job));
+	}
+}
+
+void TaskGroup::wait()
+{
+	while (pending > 0) {
+		// help with any job while the ones of the group run in other threads
+		if (!job_system->run_one()) {
+			std::this_thread::yield();
+		}
+	}
+	// the last job may still be releasing the dependents
+	std::lock_guard<std::mutex> lock(mutex);
+}
+
+bool TaskGroup::is_done() const
+{
+	return pending == 0;
+}
\ No newline at end of file
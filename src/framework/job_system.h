@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+// Pool of worker threads with one job queue each. A worker takes the newest job of its own queue (the data of the job that queued
+// it is still in cache) and, when it runs out, steals the oldest job of another queue, so the work spreads without a central queue
+// Waiting for a group runs jobs meanwhile, so the main thread also works and jobs can wait for the jobs they queue
+// GL calls must stay on the main thread: queue them with run_on_main_thread
+class JobSystem
+{
+public:
+	struct Job
+	{
+		std::function<void()> function;
+		TaskGroup* group = nullptr;
+	};
+
+protected:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	// queue 0 is for the threads that are not workers (e.g. the main thread), queue i + 1 for the worker i
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+
+	// sleeping workers are woken up when there are queued jobs
+	std::mutex sleep_mutex;
+	std::condition_variable wake_up;
+	std::atomic<unsigned int> num_queued = 0;
+	std::atomic<bool> stopping = false;
+
+	std::mutex main_thread_mutex;
+	std::vector<std::function<void()>> main_thread_jobs;
+
+	unsigned int get_queue_index() const;
+	bool pop(unsigned int queue_index, Job& job);
+	bool steal(unsigned int queue_index, Job& job);
+	void execute(Job& job);
+	void worker_loop(unsigned int queue_index);
+
+public:
+	// Job system of the application, with a worker per core besides the main thread
+	static JobSystem& get();
+
+	JobSystem(unsigned int num_workers);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int get_num_workers() const;
+	// Number of threads that run jobs (the workers and the one that waits)
+	unsigned int get_num_threads() const;
+
+	// Queue a job of the group in the queue of the calling thread (see TaskGroup::run)
+	void submit(Job&& job);
+	// Run a queued job, if any, in the calling thread. Returns false if there was none
+	bool run_one();
+
+	// Run function(begin, end) over the ranges of [0, count) in parallel and wait for all of them. The ranges have at least
+	// min_range elements, and there are a few per thread so the threads that finish first take the work of the slower ones
+	void parallel_for(unsigned int count, const std::function<void(unsigned int begin, unsigned int end)>& function, unsigned int min_range = 1);
+
+	// Queue a function to run on the main thread (the one with the GL context) by the next process_main_thread_jobs
+	void run_on_main_thread(std::function<void()> function);
+	// Run the functions queued for the main thread (called once per frame by the main loop)
+	void process_main_thread_jobs();
+};
+
+// Jobs that can be waited for together. A group can depend on other groups: its jobs are held until the jobs that those groups
+// had when the dependency was added are finished (so run the jobs of a group before adding it as a dependency)
+// A group must not be destroyed while it has jobs: the destructor waits for them
+class TaskGroup
+{
+	friend class JobSystem;
+
+protected:
+	JobSystem* job_system = nullptr;
+	std::atomic<unsigned int> pending = 0;	// jobs not finished (also the held ones)
+
+	std::mutex mutex;
+	unsigned int num_blockers = 0;			// unfinished groups it depends on
+	std::vector<JobSystem::Job> held_jobs;	// jobs waiting for the groups it depends on
+	std::vector<TaskGroup*> dependents;		// groups waiting for this one
+
+	void on_job_finished();
+	void on_dependency_finished();
+
+public:
+	TaskGroup(JobSystem& job_system = JobSystem::get());
+	~TaskGroup();
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	// Hold the jobs of this group until the jobs the other group has now are finished (nothing if it has none)
+	void depends_on(TaskGroup& group);
+	// Run the function in any thread of the job system
+	void run(std::function<void()> function);
+	// Wait until all the jobs of the group are finished, running queued jobs meanwhile
+	void wait();
+	bool is_done() const;
+};
+
+// Run function(i) for every i in [0, count) with the job system of the application, in ranges of at least min_range elements
+template <typename Function>
+void parallel_for(unsigned int count, Function&& function, unsigned int min_range = 1)
+{
+	JobSystem::get().parallel_for(count, [&function](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++) {
+			function(i);
+		}
+	}, min_range);
+}
\ No newline at end of file
@@ -76,8 +76,10 @@ Pose load_bind_pose(const cgltf_data* data)
 	unsigned int num_bones = rest_pose.size();
 	std::vector<mat4> world_bind_pose(num_bones);
 	// initialize the array of matrices with the global transforms of the rest pose bones
+	std::vector<Transform> world_rest_pose;
+	rest_pose.get_global_transforms(world_rest_pose);
 	for (unsigned int i = 0; i < num_bones; i++) {
-		world_bind_pose[i] = transform_to_mat4(rest_pose.get_global_transform(i));
+		world_bind_pose[i] = transform_to_mat4(world_rest_pose[i]);
 	}
 
 	// get number of skins (skinned meshes)
@@ -96,7 +98,7 @@ Pose load_bind_pose(const cgltf_data* data)
 			mat4 inv_bind_matrix = mat4(matrix);
 			
 			//compute the world matrix of the bind pose
-			mat4 bind_matrix = inverse(inv_bind_matrix);
+			mat4 bind_matrix = inverse_affine(inv_bind_matrix);
 					 
 			// update the world_bind_pose array with the global matrix of the joint in bind pose.
 			int joint_index = GLTFHelpers::get_joint_index(skin->joints[j], skin->joints, num_joints);
@@ -148,11 +150,70 @@ mat4 load_armature_transform(const cgltf_data* data)
 
 Skeleton load_skeleton(const cgltf_data* data)
 {	
-	return Skeleton(
-		load_rest_pose(data),
-		load_bind_pose(data),
-		load_joint_names(data)
-	);
+	Pose rest_pose = load_rest_pose(data);
+	Pose bind_pose = load_bind_pose(data);
+	std::vector<std::string> names = load_joint_names(data);
+
+	// store the joints parents first so the global pose can be computed in a single pass
+	// the same remap is applied to the joint indices of the skinned meshes (see mesh_from_attribute)
+	std::vector<unsigned int> remap = GLTFHelpers::get_joint_remap(data->skins[0]);
+	bool is_identity = true;
+	for (unsigned int i = 0; i < remap.size(); i++) {
+		is_identity &= remap[i] == i;
+	}
+	if (!is_identity) {
+		rest_pose.remap(remap);
+		bind_pose.remap(remap);
+
+		std::vector<std::string> remapped_names(names.size());
+		for (unsigned int i = 0; i < names.size(); i++) {
+			remapped_names[remap[i]] = names[i];
+		}
+		names = remapped_names;
+	}
+
+	return Skeleton(rest_pose, bind_pose, names);
+}
+
+// loads every animation of the file as a clip of the skeleton (the joint ids follow the same remap as load_skeleton)
+std::vector<Clip> load_animation_clips(const cgltf_data* data)
+{
+	std::vector<Clip> clips;
+	if (data->skins_count == 0) {
+		return clips;
+	}
+
+	cgltf_skin& skin = data->skins[0];
+	std::vector<unsigned int> remap = GLTFHelpers::get_joint_remap(skin);
+
+	unsigned int num_clips = data->animations_count;
+	clips.resize(num_clips);
+	for (unsigned int i = 0; i < num_clips; i++) {
+		cgltf_animation& animation = data->animations[i];
+		clips[i].set_name(animation.name ? animation.name : "Clip_" + std::to_string(i));
+
+		for (unsigned int j = 0; j < animation.channels_count; j++) {
+			cgltf_animation_channel& channel = animation.channels[j];
+			// only the joints of the skin are animated
+			int joint_index = GLTFHelpers::get_joint_index(channel.target_node, skin.joints, skin.joints_count);
+			if (joint_index < 0) {
+				continue;
+			}
+
+			TransformTrack& track = clips[i].get_joint_track(remap[joint_index]);
+			if (channel.target_path == cgltf_animation_path_type_translation) {
+				GLTFHelpers::track_from_channel<vec3, 3>(track.position, channel);
+			}
+			else if (channel.target_path == cgltf_animation_path_type_rotation) {
+				GLTFHelpers::track_from_channel<quat, 4>(track.rotation, channel);
+			}
+			else if (channel.target_path == cgltf_animation_path_type_scale) {
+				GLTFHelpers::track_from_channel<vec3, 3>(track.scale, channel);
+			}
+		}
+		clips[i].recalculate_duration();
+	}
+	return clips;
 }
 
 SkinnedEntity* load_meshes(const cgltf_data* data)
@@ -352,6 +413,17 @@ int GLTFHelpers::get_joint_index(cgltf_node* joint, cgltf_node** all_joints, uns
 	return -1;
 }
 
+// Gets the new index of each joint of the skin (remap[joint_index] = new_index) so parents are stored before their children
+std::vector<unsigned int> GLTFHelpers::get_joint_remap(const cgltf_skin& skin)
+{
+	unsigned int num_joints = skin.joints_count;
+	std::vector<int> parents(num_joints);
+	for (unsigned int i = 0; i < num_joints; ++i) {
+		parents[i] = get_joint_index(skin.joints[i]->parent, skin.joints, num_joints);
+	}
+	return Pose::get_topological_remap(parents);
+}
+
 // Reads the floating-point values of a gltf accessor and put them into a vector of floats
 void GLTFHelpers::get_scalar_values(std::vector<float>& out, unsigned int comp_count, const cgltf_accessor& in_accessor)
 {
@@ -361,6 +433,48 @@ void GLTFHelpers::get_scalar_values(std::vector<float>& out, unsigned int comp_c
 	}
 }
 
+static void value_from_floats(vec3& out, const float* v)
+{
+	out = vec3(v[0], v[1], v[2]);
+}
+
+static void value_from_floats(quat& out, const float* v)
+{
+	out = quat(v[0], v[1], v[2], v[3]);
+}
+
+// Reads the keys of an animation channel (N floats per value) into a track
+template <typename T, unsigned int N>
+void GLTFHelpers::track_from_channel(Track<T>& out, const cgltf_animation_channel& channel)
+{
+	cgltf_animation_sampler& sampler = *channel.sampler;
+
+	std::vector<float> times;
+	get_scalar_values(times, 1, *sampler.input);
+	std::vector<float> output;
+	get_scalar_values(output, N, *sampler.output);
+
+	unsigned int num_keys = (unsigned int)times.size();
+	std::vector<T> values(num_keys);
+	if (sampler.interpolation == cgltf_interpolation_type_cubic_spline) {
+		// every key stores its in-tangent, value and out-tangent
+		std::vector<T> in_tangents(num_keys), out_tangents(num_keys);
+		for (unsigned int i = 0; i < num_keys; i++) {
+			value_from_floats(in_tangents[i], &output[(i * 3 + 0) * N]);
+			value_from_floats(values[i], &output[(i * 3 + 1) * N]);
+			value_from_floats(out_tangents[i], &output[(i * 3 + 2) * N]);
+		}
+		out.set_keys(times, values, in_tangents, out_tangents);
+	}
+	else {
+		for (unsigned int i = 0; i < num_keys; i++) {
+			value_from_floats(values[i], &output[i * N]);
+		}
+		Interpolation interpolation = sampler.interpolation == cgltf_interpolation_type_step ? Interpolation::Constant : Interpolation::Linear;
+		out.set_keys(times, values, interpolation);
+	}
+}
+
 /*
 It takes a mesh and a cgltf_attribute function, along with some additional data required for parsing.
 The attribute contains one of our mesh components, such as the position, normal, UV coordinate, weights, or influences.
@@ -395,6 +509,12 @@ void GLTFHelpers::mesh_from_attribute(Mesh& out_mesh, cgltf_attribute& attribute
 	std::vector<ivec4>& influences = out_mesh.bones; //out_mesh.get_influences();
 	std::vector<vec4>& weights = out_mesh.weights; //out_mesh.get_weights();
 
+	std::vector<unsigned int> joint_remap;
+	if (skin && attrib_type == cgltf_attribute_type_joints) {
+		joint_remap = get_joint_remap(*skin);
+	}
+	unsigned int num_invalid_joints = 0;
+
 	// loop through all the values in the current accessor and assign them to the appropriate vector based on the accessor type
 	for (unsigned int i = 0; i < acessor_count; ++i) {
 		int index = i * component_count;
@@ -448,9 +568,27 @@ void GLTFHelpers::mesh_from_attribute(Mesh& out_mesh, cgltf_attribute& attribute
 			joints.z = std::max(0, joints.z);
 			joints.w = std::max(0, joints.w);
 
+			// Use the same joint order as the skeleton (parents first, see load_skeleton)
+			// An index out of the skin would read out of the palette: it is counted and set to the first joint
+			if (joint_remap.size()) {
+				for (int* joint : { &joints.x, &joints.y, &joints.z, &joints.w }) {
+					if (*joint < (int)joint_remap.size()) {
+						*joint = joint_remap[*joint];
+					}
+					else {
+						*joint = 0;
+						num_invalid_joints++;
+					}
+				}
+			}
+
 			influences.push_back(joints);
 		}
 		break;
 		}
 	}
+
+	if (num_invalid_joints) {
+		std::cout << "[Warning] " << num_invalid_joints << " joint indices are out of the skin (" << joint_remap.size() << " joints), they were set to 0" << std::endl;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "batch.h"
+#include "batch_kernels.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// The kernels work on plain floats
+static_assert(sizeof(Transform) == 10 * sizeof(float), "Transform must be 10 floats");
+static_assert(sizeof(quat) == 4 * sizeof(float), "quat must be 4 floats");
+static_assert(sizeof(mat4) == 16 * sizeof(float), "mat4 must be 16 floats");
+static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 must be 3 floats");
+static_assert(sizeof(vec4) == 4 * sizeof(float), "vec4 must be 4 floats");
+static_assert(sizeof(dual_quat) == 8 * sizeof(float), "dual_quat must be 8 floats");
+static_assert(sizeof(ivec4) == 4 * sizeof(int), "ivec4 must be 4 ints");
+
+static bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	// the OS must also save the AVX registers (OSXSAVE and XCR0)
+	bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	return fma && os_avx && avx2;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return false;
+#endif
+}
+
+// Picked the first time they are needed
+static const BatchKernels& get_kernels()
+{
+	static BatchKernels kernels = []() {
+		BatchKernels k;
+		if (!(cpu_supports_avx2() && get_batch_kernels_avx2(k))) {
+			get_batch_kernels_default(k);
+		}
+		return k;
+	}();
+	return kernels;
+}
+
+void combine(const Transform* a, const Transform* b, Transform* out, unsigned int count)
+{
+	get_kernels().combine((const float*)a, (const float*)b, (float*)out, count);
+}
+
+void mix(const Transform* a, const Transform* b, float t, Transform* out, unsigned int count)
+{
+	get_kernels().mix((const float*)a, (const float*)b, t, (float*)out, count);
+}
+
+void nlerp(const quat* from, const quat* to, float t, quat* out, unsigned int count)
+{
+	get_kernels().nlerp((const float*)from, (const float*)to, t, (float*)out, count);
+}
+
+void multiply(const mat4* a, const mat4* b, mat4* out, unsigned int count)
+{
+	get_kernels().multiply((const float*)a, (const float*)b, (float*)out, count);
+}
+
+void transform_points(const mat4& m, const vec3* points, vec3* out, unsigned int count)
+{
+	get_kernels().transform_points(m.data, (const float*)points, (float*)out, count);
+}
+
+void skin(const mat4* palette, const vec3* positions, const vec3* normals, const ivec4* bones, const vec4* weights,
+	vec3* out_positions, vec3* out_normals, unsigned int count)
+{
+	get_kernels().skin(palette[0].data, (const float*)positions, (const float*)normals, (const int*)bones, (const float*)weights,
+		(float*)out_positions, (float*)out_normals, count);
+}
+
+void skin(const dual_quat* palette, const vec3* positions, const vec3* normals, const ivec4* bones, const vec4* weights,
+	vec3* out_positions, vec3* out_normals, unsigned int count)
+{
+	get_kernels().skin_dual_quat(palette[0].real.v, (const float*)positions, (const float*)normals, (const int*)bones, (const float*)weights,
+		(float*)out_positions, (float*)out_normals, count);
+}
+
+const char* get_batch_instruction_set()
+{
+	return get_kernels().name;
+}
\ No newline at end of file
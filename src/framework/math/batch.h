@@ -0,0 +1,32 @@
+#pragma once
+
+#include "vec4.h"
+#include "mat4.h"
+#include "quat.h"
+#include "transform.h"
+#include "dual_quat.h"
+
+// Array versions of the math functions: they process count elements at once with the widest SIMD instructions
+// supported by the CPU (picked at runtime, see get_batch_instruction_set). out can be the same array as an input
+
+// out[i] = combine(a[i], b[i])
+void combine(const Transform* a, const Transform* b, Transform* out, unsigned int count);
+// out[i] = mix(a[i], b[i], t)
+void mix(const Transform* a, const Transform* b, float t, Transform* out, unsigned int count);
+// out[i] = nlerp(from[i], to[i], t)
+void nlerp(const quat* from, const quat* to, float t, quat* out, unsigned int count);
+// out[i] = a[i] * b[i]
+void multiply(const mat4* a, const mat4* b, mat4* out, unsigned int count);
+// out[i] = transform_point(m, points[i])
+void transform_points(const mat4& m, const vec3* points, vec3* out, unsigned int count);
+// Linear blend skinning: out_positions[i] and out_normals[i] are positions[i] and normals[i] transformed by the sum of the palette
+// matrices of bones[i] scaled by weights[i] (the normals are not normalized, as in the skinning shaders). normals can be null
+void skin(const mat4* palette, const vec3* positions, const vec3* normals, const ivec4* bones, const vec4* weights,
+	vec3* out_positions, vec3* out_normals, unsigned int count);
+// Dual quaternion skinning: the same with the normalized sum of the palette dual quaternions of bones[i] scaled by weights[i] (the
+// weights of the dual quaternions in the other hemisphere than the one of the first bone are negated, so they blend the shortest way)
+void skin(const dual_quat* palette, const vec3* positions, const vec3* normals, const ivec4* bones, const vec4* weights,
+	vec3* out_positions, vec3* out_normals, unsigned int count);
+
+// Name of the instruction set used by the functions above
+const char* get_batch_instruction_set();
\ No newline at end of file
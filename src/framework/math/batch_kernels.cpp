@@ -0,0 +1,439 @@
+#include "batch_kernels.h"
+#include "simd_transform.h"
+
+// This file is also compiled with AVX2 and FMA by batch_kernels_avx2.cpp, so it must only use the functions of simd.h,
+// simd_transform.h and its own static functions
+
+static const int TRANSFORM_FLOATS = 10;
+static const int QUAT_FLOATS = 4;
+static const int MAT4_FLOATS = 16;
+static const int POINT_FLOATS = 3;
+static const int DUAL_QUAT_FLOATS = 8;
+
+// Runs block(a, b, out) on every full block of SIMD_WIDTH elements, and on a zero padded copy of the remaining ones
+// A, B and OUT are the number of floats of each element (B = 0 if b is the same for every element)
+template <int A, int B, int OUT, typename Block>
+static SIMD_INLINE void for_each_block(const float* a, const float* b, float* out, unsigned int count, Block block)
+{
+	unsigned int k = 0;
+	for (; k + SIMD_WIDTH <= count; k += SIMD_WIDTH) {
+		block(a + k * A, b + k * B, out + k * OUT);
+	}
+	if (k == count) {
+		return;
+	}
+
+	unsigned int rest = count - k;
+	float tail_a[SIMD_WIDTH * A] = { };
+	float tail_b[SIMD_WIDTH * (B > 0 ? B : 1)] = { };
+	float tail_out[SIMD_WIDTH * OUT] = { };
+	memcpy(tail_a, a + k * A, rest * A * sizeof(float));
+	if (B > 0) {
+		memcpy(tail_b, b + k * B, rest * B * sizeof(float));
+	}
+	block(tail_a, B > 0 ? tail_b : b, tail_out);
+	memcpy(out + k * OUT, tail_out, rest * OUT * sizeof(float));
+}
+
+static SIMD_INLINE simd_transform gather_transforms(const float* t)
+{
+	simd_transform block;
+	block.px = simd_gather_stride(t + 0, TRANSFORM_FLOATS);
+	block.py = simd_gather_stride(t + 1, TRANSFORM_FLOATS);
+	block.pz = simd_gather_stride(t + 2, TRANSFORM_FLOATS);
+	block.rx = simd_gather_stride(t + 3, TRANSFORM_FLOATS);
+	block.ry = simd_gather_stride(t + 4, TRANSFORM_FLOATS);
+	block.rz = simd_gather_stride(t + 5, TRANSFORM_FLOATS);
+	block.rw = simd_gather_stride(t + 6, TRANSFORM_FLOATS);
+	block.sx = simd_gather_stride(t + 7, TRANSFORM_FLOATS);
+	block.sy = simd_gather_stride(t + 8, TRANSFORM_FLOATS);
+	block.sz = simd_gather_stride(t + 9, TRANSFORM_FLOATS);
+	return block;
+}
+
+static SIMD_INLINE void scatter_transforms(float* t, const simd_transform& block)
+{
+	simd_scatter_stride(t + 0, TRANSFORM_FLOATS, block.px);
+	simd_scatter_stride(t + 1, TRANSFORM_FLOATS, block.py);
+	simd_scatter_stride(t + 2, TRANSFORM_FLOATS, block.pz);
+	simd_scatter_stride(t + 3, TRANSFORM_FLOATS, block.rx);
+	simd_scatter_stride(t + 4, TRANSFORM_FLOATS, block.ry);
+	simd_scatter_stride(t + 5, TRANSFORM_FLOATS, block.rz);
+	simd_scatter_stride(t + 6, TRANSFORM_FLOATS, block.rw);
+	simd_scatter_stride(t + 7, TRANSFORM_FLOATS, block.sx);
+	simd_scatter_stride(t + 8, TRANSFORM_FLOATS, block.sy);
+	simd_scatter_stride(t + 9, TRANSFORM_FLOATS, block.sz);
+}
+
+static void combine_kernel(const float* a, const float* b, float* out, unsigned int count)
+{
+	for_each_block<TRANSFORM_FLOATS, TRANSFORM_FLOATS, TRANSFORM_FLOATS>(a, b, out, count, [](const float* a, const float* b, float* out) {
+		scatter_transforms(out, simd_combine(gather_transforms(a), gather_transforms(b)));
+	});
+}
+
+static void mix_kernel(const float* a, const float* b, float t, float* out, unsigned int count)
+{
+	simd_float weight = simd_set1(t);
+	for_each_block<TRANSFORM_FLOATS, TRANSFORM_FLOATS, TRANSFORM_FLOATS>(a, b, out, count, [weight](const float* a, const float* b, float* out) {
+		scatter_transforms(out, simd_mix(gather_transforms(a), gather_transforms(b), weight));
+	});
+}
+
+static void nlerp_kernel(const float* from, const float* to, float t, float* out, unsigned int count)
+{
+	simd_float weight = simd_set1(t);
+	for_each_block<QUAT_FLOATS, QUAT_FLOATS, QUAT_FLOATS>(from, to, out, count, [weight](const float* a, const float* b, float* out) {
+		simd_float x, y, z, w;
+		simd_nlerp(simd_gather_stride(a + 0, QUAT_FLOATS), simd_gather_stride(a + 1, QUAT_FLOATS), simd_gather_stride(a + 2, QUAT_FLOATS), simd_gather_stride(a + 3, QUAT_FLOATS),
+			simd_gather_stride(b + 0, QUAT_FLOATS), simd_gather_stride(b + 1, QUAT_FLOATS), simd_gather_stride(b + 2, QUAT_FLOATS), simd_gather_stride(b + 3, QUAT_FLOATS),
+			weight, x, y, z, w);
+		simd_scatter_stride(out + 0, QUAT_FLOATS, x);
+		simd_scatter_stride(out + 1, QUAT_FLOATS, y);
+		simd_scatter_stride(out + 2, QUAT_FLOATS, z);
+		simd_scatter_stride(out + 3, QUAT_FLOATS, w);
+	});
+}
+
+// out = a * b for every pair of matrices. Column j of the result is a.col0 * b[j].x + a.col1 * b[j].y + a.col2 * b[j].z + a.col3 * b[j].w,
+// so a whole column (two with AVX) is computed at once instead of transposing blocks of matrices
+static void multiply_kernel(const float* a, const float* b, float* out, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++, a += MAT4_FLOATS, b += MAT4_FLOATS, out += MAT4_FLOATS) {
+#if defined(SIMD_AVX)
+		__m256 c0 = _mm256_broadcast_ps((const __m128*)(a + 0));
+		__m256 c1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+		__m256 c2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+		__m256 c3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+		// columns j and j + 1 of b: permute repeats one of their components in each half
+		__m256 b01 = _mm256_loadu_ps(b + 0);
+		__m256 b23 = _mm256_loadu_ps(b + 8);
+		__m256 r01 = simd_madd(c3, _mm256_permute_ps(b01, 0xFF), simd_madd(c2, _mm256_permute_ps(b01, 0xAA), simd_madd(c1, _mm256_permute_ps(b01, 0x55), simd_mul(c0, _mm256_permute_ps(b01, 0x00)))));
+		__m256 r23 = simd_madd(c3, _mm256_permute_ps(b23, 0xFF), simd_madd(c2, _mm256_permute_ps(b23, 0xAA), simd_madd(c1, _mm256_permute_ps(b23, 0x55), simd_mul(c0, _mm256_permute_ps(b23, 0x00)))));
+		_mm256_storeu_ps(out + 0, r01);
+		_mm256_storeu_ps(out + 8, r23);
+#elif defined(SIMD_SSE)
+		__m128 c0 = _mm_loadu_ps(a + 0), c1 = _mm_loadu_ps(a + 4), c2 = _mm_loadu_ps(a + 8), c3 = _mm_loadu_ps(a + 12);
+		__m128 r[4];
+		for (int j = 0; j < 4; j++) {
+			__m128 bj = _mm_loadu_ps(b + j * 4);
+			r[j] = simd_madd(c3, _mm_shuffle_ps(bj, bj, 0xFF), simd_madd(c2, _mm_shuffle_ps(bj, bj, 0xAA), simd_madd(c1, _mm_shuffle_ps(bj, bj, 0x55), simd_mul(c0, _mm_shuffle_ps(bj, bj, 0x00)))));
+		}
+		for (int j = 0; j < 4; j++) {
+			_mm_storeu_ps(out + j * 4, r[j]);
+		}
+#else
+		float r[MAT4_FLOATS];
+		for (int j = 0; j < 4; j++) {
+			for (int row = 0; row < 4; row++) {
+				r[j * 4 + row] = a[row] * b[j * 4] + a[4 + row] * b[j * 4 + 1] + a[8 + row] * b[j * 4 + 2] + a[12 + row] * b[j * 4 + 3];
+			}
+		}
+		memcpy(out, r, sizeof(r));
+#endif
+	}
+}
+
+static void transform_points_kernel(const float* m, const float* points, float* out, unsigned int count)
+{
+	simd_float c[12];
+	for (int i = 0; i < 12; i++) {
+		c[i] = simd_set1(m[i < 9 ? i / 3 * 4 + i % 3 : 12 + i - 9]);
+	}
+	for_each_block<POINT_FLOATS, 0, POINT_FLOATS>(points, m, out, count, [&c](const float* p, const float*, float* out) {
+		simd_float x = simd_gather_stride(p + 0, POINT_FLOATS);
+		simd_float y = simd_gather_stride(p + 1, POINT_FLOATS);
+		simd_float z = simd_gather_stride(p + 2, POINT_FLOATS);
+		// c[0..8] are the first 3 rows of the first 3 columns, c[9..11] the translation
+		simd_scatter_stride(out + 0, POINT_FLOATS, simd_madd(c[0], x, simd_madd(c[3], y, simd_madd(c[6], z, c[9]))));
+		simd_scatter_stride(out + 1, POINT_FLOATS, simd_madd(c[1], x, simd_madd(c[4], y, simd_madd(c[7], z, c[10]))));
+		simd_scatter_stride(out + 2, POINT_FLOATS, simd_madd(c[2], x, simd_madd(c[5], y, simd_madd(c[8], z, c[11]))));
+	});
+}
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+// Blend the columns of the skin matrices of the 4 influences of a vertex, then transform its position and normal by them
+static SIMD_INLINE void skin_vertex(const float* palette, const float* position, const float* normal, const int* bones, const float* weights,
+	float* out_position, float* out_normal)
+{
+	__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+	for (int k = 0; k < 4; k++) {
+		if (weights[k] == 0.0f) {
+			continue;
+		}
+		const float* m = palette + bones[k] * MAT4_FLOATS;
+		__m128 w = _mm_set1_ps(weights[k]);
+		c0 = _mm_add_ps(_mm_mul_ps(w, _mm_loadu_ps(m + 0)), c0);
+		c1 = _mm_add_ps(_mm_mul_ps(w, _mm_loadu_ps(m + 4)), c1);
+		c2 = _mm_add_ps(_mm_mul_ps(w, _mm_loadu_ps(m + 8)), c2);
+		c3 = _mm_add_ps(_mm_mul_ps(w, _mm_loadu_ps(m + 12)), c3);
+	}
+	alignas(16) float result[4];
+	__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(position[0])), _mm_mul_ps(c1, _mm_set1_ps(position[1]))), _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(position[2])), c3));
+	_mm_store_ps(result, p);
+	memcpy(out_position, result, POINT_FLOATS * sizeof(float));
+	if (normal) {
+		__m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(normal[0])), _mm_mul_ps(c1, _mm_set1_ps(normal[1]))), _mm_mul_ps(c2, _mm_set1_ps(normal[2])));
+		_mm_store_ps(result, n);
+		memcpy(out_normal, result, POINT_FLOATS * sizeof(float));
+	}
+}
+#endif
+
+// Linear blend skinning with 4 influences per vertex. The skin matrix of a vertex is the sum of the columns of the skin matrices of its
+// bones scaled by their weights (a column at once, two vertices at once with AVX), so the points do not need to be transposed
+static void skin_kernel(const float* palette, const float* positions, const float* normals, const int* bones, const float* weights,
+	float* out_positions, float* out_normals, unsigned int count)
+{
+	unsigned int i = 0;
+#if defined(SIMD_AVX)
+	// the loads of a pair read 4 floats from the point of the second vertex, so the last vertex is left for the single vertex loop
+	for (; i + 3 <= count; i += 2) {
+		const int* b = bones + i * 4;
+		// weights of the first vertex in the low half and of the second one in the high half: permute repeats one in each half
+		__m256 w = _mm256_loadu_ps(weights + i * 4);
+		__m256 c0 = _mm256_setzero_ps(), c1 = _mm256_setzero_ps(), c2 = _mm256_setzero_ps(), c3 = _mm256_setzero_ps();
+		for (int k = 0; k < 4; k++) {
+			const float* ma = palette + b[k] * MAT4_FLOATS;
+			const float* mb = palette + b[4 + k] * MAT4_FLOATS;
+			__m256 wk = _mm256_permutevar_ps(w, _mm256_set1_epi32(k));
+			c0 = simd_madd(wk, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ma + 0)), _mm_loadu_ps(mb + 0), 1), c0);
+			c1 = simd_madd(wk, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ma + 4)), _mm_loadu_ps(mb + 4), 1), c1);
+			c2 = simd_madd(wk, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ma + 8)), _mm_loadu_ps(mb + 8), 1), c2);
+			c3 = simd_madd(wk, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(ma + 12)), _mm_loadu_ps(mb + 12), 1), c3);
+		}
+		alignas(SIMD_ALIGNMENT) float result[8];
+		const float* p = positions + i * POINT_FLOATS;
+		__m256 pp = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 3), 1);
+		simd_store(result, simd_madd(c0, _mm256_permute_ps(pp, 0x00), simd_madd(c1, _mm256_permute_ps(pp, 0x55), simd_madd(c2, _mm256_permute_ps(pp, 0xAA), c3))));
+		memcpy(out_positions + i * POINT_FLOATS, result, POINT_FLOATS * sizeof(float));
+		memcpy(out_positions + (i + 1) * POINT_FLOATS, result + 4, POINT_FLOATS * sizeof(float));
+		if (normals) {
+			const float* n = normals + i * POINT_FLOATS;
+			__m256 nn = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(n)), _mm_loadu_ps(n + 3), 1);
+			simd_store(result, simd_madd(c0, _mm256_permute_ps(nn, 0x00), simd_madd(c1, _mm256_permute_ps(nn, 0x55), simd_mul(c2, _mm256_permute_ps(nn, 0xAA)))));
+			memcpy(out_normals + i * POINT_FLOATS, result, POINT_FLOATS * sizeof(float));
+			memcpy(out_normals + (i + 1) * POINT_FLOATS, result + 4, POINT_FLOATS * sizeof(float));
+		}
+	}
+#endif
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+	for (; i < count; i++) {
+		skin_vertex(palette, positions + i * POINT_FLOATS, normals ? normals + i * POINT_FLOATS : nullptr, bones + i * 4, weights + i * 4,
+			out_positions + i * POINT_FLOATS, normals ? out_normals + i * POINT_FLOATS : nullptr);
+	}
+#else
+	for (; i < count; i++) {
+		const int* b = bones + i * 4;
+		const float* w = weights + i * 4;
+		float m[MAT4_FLOATS] = { };
+		for (int k = 0; k < 4; k++) {
+			const float* bone = palette + b[k] * MAT4_FLOATS;
+			for (int j = 0; j < MAT4_FLOATS; j++) {
+				m[j] += bone[j] * w[k];
+			}
+		}
+		const float* p = positions + i * POINT_FLOATS;
+		float* out = out_positions + i * POINT_FLOATS;
+		for (int row = 0; row < 3; row++) {
+			out[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+		}
+		if (normals) {
+			const float* n = normals + i * POINT_FLOATS;
+			out = out_normals + i * POINT_FLOATS;
+			for (int row = 0; row < 3; row++) {
+				out[row] = m[row] * n[0] + m[4 + row] * n[1] + m[8 + row] * n[2];
+			}
+		}
+	}
+#endif
+}
+
+#if defined(SIMD_AVX)
+// Weighted sum of the dual quaternions of the bones of a vertex (real part in the low half, dual part in the high half)
+static SIMD_INLINE __m256 blend_dual_quat(const float* palette, const int* bones, const float* weights)
+{
+	__m256 q0 = _mm256_loadu_ps(palette + bones[0] * DUAL_QUAT_FLOATS);
+	__m128 r0 = _mm256_castps256_ps128(q0);
+	__m256 blend = _mm256_mul_ps(_mm256_set1_ps(weights[0]), q0);
+	for (int k = 1; k < 4; k++) {
+		__m256 q = _mm256_loadu_ps(palette + bones[k] * DUAL_QUAT_FLOATS);
+		// the same rotation is q and -q: take the one in the hemisphere of the first bone
+		float hemisphere = _mm_cvtss_f32(_mm_dp_ps(_mm256_castps256_ps128(q), r0, 0xF1));
+		blend = simd_madd(_mm256_set1_ps(hemisphere < 0.0f ? -weights[k] : weights[k]), q, blend);
+	}
+	return blend;
+}
+#elif defined(SIMD_SSE)
+static SIMD_INLINE void blend_dual_quat(const float* palette, const int* bones, const float* weights, __m128& real, __m128& dual)
+{
+	const float* q0 = palette + bones[0] * DUAL_QUAT_FLOATS;
+	__m128 r0 = _mm_loadu_ps(q0);
+	__m128 w = _mm_set1_ps(weights[0]);
+	real = _mm_mul_ps(w, r0);
+	dual = _mm_mul_ps(w, _mm_loadu_ps(q0 + 4));
+	for (int k = 1; k < 4; k++) {
+		const float* q = palette + bones[k] * DUAL_QUAT_FLOATS;
+		__m128 r = _mm_loadu_ps(q);
+		__m128 products = _mm_mul_ps(r, r0);
+		products = _mm_add_ps(products, _mm_movehl_ps(products, products));
+		float hemisphere = _mm_cvtss_f32(_mm_add_ss(products, _mm_shuffle_ps(products, products, 1)));
+		w = _mm_set1_ps(hemisphere < 0.0f ? -weights[k] : weights[k]);
+		real = simd_madd(w, r, real);
+		dual = simd_madd(w, _mm_loadu_ps(q + 4), dual);
+	}
+}
+#endif
+
+// Blended dual quaternions of SIMD_WIDTH vertices, as the components of their real (r) and dual (d) parts. Every vertex is blended
+// with contiguous loads of its dual quaternions and the blends are transposed, which is faster than gathering every component
+static SIMD_INLINE void blend_dual_quats(const float* palette, const int* bones, const float* weights, simd_float* r, simd_float* d)
+{
+#if defined(SIMD_AVX)
+	__m256 q[8];
+	for (int lane = 0; lane < 8; lane++) {
+		q[lane] = blend_dual_quat(palette, bones + lane * 4, weights + lane * 4);
+	}
+	// 8x8 transpose: the component c of every vertex to r[c] (c < 4) or d[c - 4]
+	__m256 t[8], u[8];
+	for (int i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_ps(q[i], q[i + 1]);
+		t[i + 1] = _mm256_unpackhi_ps(q[i], q[i + 1]);
+	}
+	for (int i = 0; i < 8; i += 4) {
+		u[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+		u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+		u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+		u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+	}
+	for (int c = 0; c < 4; c++) {
+		r[c] = _mm256_permute2f128_ps(u[c], u[c + 4], 0x20);
+		d[c] = _mm256_permute2f128_ps(u[c], u[c + 4], 0x31);
+	}
+#elif defined(SIMD_SSE)
+	for (int lane = 0; lane < 4; lane++) {
+		blend_dual_quat(palette, bones + lane * 4, weights + lane * 4, r[lane], d[lane]);
+	}
+	_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+	_MM_TRANSPOSE4_PS(d[0], d[1], d[2], d[3]);
+#else
+	const float* q0 = palette + bones[0] * DUAL_QUAT_FLOATS;
+	for (int c = 0; c < 4; c++) {
+		r[c] = weights[0] * q0[c];
+		d[c] = weights[0] * q0[4 + c];
+	}
+	for (int k = 1; k < 4; k++) {
+		const float* q = palette + bones[k] * DUAL_QUAT_FLOATS;
+		// the same rotation is q and -q: take the one in the hemisphere of the first bone
+		float hemisphere = q[0] * q0[0] + q[1] * q0[1] + q[2] * q0[2] + q[3] * q0[3];
+		float w = hemisphere < 0.0f ? -weights[k] : weights[k];
+		for (int c = 0; c < 4; c++) {
+			r[c] += w * q[c];
+			d[c] += w * q[4 + c];
+		}
+	}
+#endif
+}
+
+// Dual quaternion skinning of SIMD_WIDTH vertices at once
+static SIMD_INLINE void skin_dual_quat_block(const float* palette, const float* positions, const float* normals, const int* bones,
+	const float* weights, float* out_positions, float* out_normals)
+{
+	simd_float r[4], d[4];
+	blend_dual_quats(palette, bones, weights, r, d);
+
+	// normalize by the length of the real part (the padded lanes of the tail have no weights)
+	simd_float length_sq = simd_madd(r[0], r[0], simd_madd(r[1], r[1], simd_madd(r[2], r[2], simd_mul(r[3], r[3]))));
+	simd_float inv_length = simd_div(simd_set1(1.0f), simd_sqrt(simd_max(length_sq, simd_set1(1e-12f))));
+	for (int c = 0; c < 4; c++) {
+		r[c] = simd_mul(r[c], inv_length);
+		d[c] = simd_mul(d[c], inv_length);
+	}
+
+	// translation = 2 (w_r v_d - w_d v_r + v_r x v_d)
+	simd_float two = simd_set1(2.0f);
+	simd_float tx = simd_mul(two, simd_add(simd_sub(simd_mul(r[3], d[0]), simd_mul(d[3], r[0])), simd_sub(simd_mul(r[1], d[2]), simd_mul(r[2], d[1]))));
+	simd_float ty = simd_mul(two, simd_add(simd_sub(simd_mul(r[3], d[1]), simd_mul(d[3], r[1])), simd_sub(simd_mul(r[2], d[0]), simd_mul(r[0], d[2]))));
+	simd_float tz = simd_mul(two, simd_add(simd_sub(simd_mul(r[3], d[2]), simd_mul(d[3], r[2])), simd_sub(simd_mul(r[0], d[1]), simd_mul(r[1], d[0]))));
+
+	// rotation: v + 2 v_r x (v_r x v + w_r v)
+	auto rotate = [&](const float* v, float* out, bool translate) {
+		simd_float x = simd_gather_stride(v + 0, POINT_FLOATS);
+		simd_float y = simd_gather_stride(v + 1, POINT_FLOATS);
+		simd_float z = simd_gather_stride(v + 2, POINT_FLOATS);
+		simd_float ax = simd_madd(r[3], x, simd_sub(simd_mul(r[1], z), simd_mul(r[2], y)));
+		simd_float ay = simd_madd(r[3], y, simd_sub(simd_mul(r[2], x), simd_mul(r[0], z)));
+		simd_float az = simd_madd(r[3], z, simd_sub(simd_mul(r[0], y), simd_mul(r[1], x)));
+		x = simd_madd(two, simd_sub(simd_mul(r[1], az), simd_mul(r[2], ay)), x);
+		y = simd_madd(two, simd_sub(simd_mul(r[2], ax), simd_mul(r[0], az)), y);
+		z = simd_madd(two, simd_sub(simd_mul(r[0], ay), simd_mul(r[1], ax)), z);
+		if (translate) {
+			x = simd_add(x, tx);
+			y = simd_add(y, ty);
+			z = simd_add(z, tz);
+		}
+		simd_scatter_stride(out + 0, POINT_FLOATS, x);
+		simd_scatter_stride(out + 1, POINT_FLOATS, y);
+		simd_scatter_stride(out + 2, POINT_FLOATS, z);
+	};
+	rotate(positions, out_positions, true);
+	if (normals) {
+		rotate(normals, out_normals, false);
+	}
+}
+
+// Dual quaternion skinning with 4 influences per vertex, on blocks of SIMD_WIDTH vertices and a zero padded copy of the remaining ones
+static void skin_dual_quat_kernel(const float* palette, const float* positions, const float* normals, const int* bones, const float* weights,
+	float* out_positions, float* out_normals, unsigned int count)
+{
+	unsigned int i = 0;
+	for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+		skin_dual_quat_block(palette, positions + i * POINT_FLOATS, normals ? normals + i * POINT_FLOATS : nullptr, bones + i * 4,
+			weights + i * 4, out_positions + i * POINT_FLOATS, normals ? out_normals + i * POINT_FLOATS : nullptr);
+	}
+	if (i == count) {
+		return;
+	}
+
+	unsigned int rest = count - i;
+	float tail_positions[SIMD_WIDTH * POINT_FLOATS] = { };
+	float tail_normals[SIMD_WIDTH * POINT_FLOATS] = { };
+	int tail_bones[SIMD_WIDTH * 4] = { };
+	float tail_weights[SIMD_WIDTH * 4] = { };
+	float tail_out_positions[SIMD_WIDTH * POINT_FLOATS];
+	float tail_out_normals[SIMD_WIDTH * POINT_FLOATS];
+	memcpy(tail_positions, positions + i * POINT_FLOATS, rest * POINT_FLOATS * sizeof(float));
+	if (normals) {
+		memcpy(tail_normals, normals + i * POINT_FLOATS, rest * POINT_FLOATS * sizeof(float));
+	}
+	memcpy(tail_bones, bones + i * 4, rest * 4 * sizeof(int));
+	memcpy(tail_weights, weights + i * 4, rest * 4 * sizeof(float));
+	skin_dual_quat_block(palette, tail_positions, normals ? tail_normals : nullptr, tail_bones, tail_weights, tail_out_positions, tail_out_normals);
+	memcpy(out_positions + i * POINT_FLOATS, tail_out_positions, rest * POINT_FLOATS * sizeof(float));
+	if (normals) {
+		memcpy(out_normals + i * POINT_FLOATS, tail_out_normals, rest * POINT_FLOATS * sizeof(float));
+	}
+}
+
+#if defined(BATCH_KERNELS_AVX2)
+bool get_batch_kernels_avx2(BatchKernels& kernels)
+#else
+bool get_batch_kernels_default(BatchKernels& kernels)
+#endif
+{
+#if defined(SIMD_AVX)
+	kernels.name = "AVX2";
+#elif defined(SIMD_SSE)
+	kernels.name = "SSE2";
+#else
+	kernels.name = "Scalar";
+#endif
+	kernels.combine = combine_kernel;
+	kernels.mix = mix_kernel;
+	kernels.nlerp = nlerp_kernel;
+	kernels.multiply = multiply_kernel;
+	kernels.transform_points = transform_points_kernel;
+	kernels.skin = skin_kernel;
+	kernels.skin_dual_quat = skin_dual_quat_kernel;
+	return true;
+}
\ No newline at end of file
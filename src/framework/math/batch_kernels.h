@@ -0,0 +1,24 @@
+#pragma once
+
+// Kernels of the batched math functions (see batch.h). They work on plain floats, so the same kernels can be compiled
+// once per instruction set (batch_kernels.cpp and batch_kernels_avx2.cpp) without sharing any inline function of the math types
+// Transforms are 10 floats (position, rotation, scale), quaternions 4, matrices 16 (column-major) and points 3. The bones and the
+// weights of the skinned vertices are 4 ints and 4 floats, and dual quaternions 8 (real and dual parts)
+struct BatchKernels
+{
+	const char* name = nullptr;
+	void (*combine)(const float* a, const float* b, float* out, unsigned int count) = nullptr;
+	void (*mix)(const float* a, const float* b, float t, float* out, unsigned int count) = nullptr;
+	void (*nlerp)(const float* from, const float* to, float t, float* out, unsigned int count) = nullptr;
+	void (*multiply)(const float* a, const float* b, float* out, unsigned int count) = nullptr;
+	void (*transform_points)(const float* m, const float* points, float* out, unsigned int count) = nullptr;
+	void (*skin)(const float* palette, const float* positions, const float* normals, const int* bones, const float* weights,
+		float* out_positions, float* out_normals, unsigned int count) = nullptr;
+	void (*skin_dual_quat)(const float* palette, const float* positions, const float* normals, const int* bones, const float* weights,
+		float* out_positions, float* out_normals, unsigned int count) = nullptr;
+};
+
+// Fill the kernels compiled with the default instruction set (SSE2 on x86, scalar otherwise)
+bool get_batch_kernels_default(BatchKernels& kernels);
+// Fill the kernels compiled with AVX2 and FMA. Returns false if they were not compiled (the CPU support is checked in batch.cpp)
+bool get_batch_kernels_avx2(BatchKernels& kernels);
\ No newline at end of file
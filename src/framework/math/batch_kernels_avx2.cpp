@@ -0,0 +1,14 @@
+// The kernels of batch_kernels.cpp compiled with AVX2 and FMA (the compiler flags of this file are set in CMakeLists.txt).
+// batch.cpp only uses them if the CPU supports both
+#define BATCH_KERNELS_AVX2
+
+#if defined(__AVX2__)
+#include "batch_kernels.cpp"
+#else
+#include "batch_kernels.h"
+
+bool get_batch_kernels_avx2(BatchKernels& kernels)
+{
+	return false;
+}
+#endif
\ No newline at end of file
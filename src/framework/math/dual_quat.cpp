@@ -0,0 +1,56 @@
+#include "dual_quat.h"
+
+#include <cmath>
+
+// The formulas use the vector and the scalar parts, so they do not depend on the order of operator* of quat
+
+dual_quat operator+(const dual_quat& a, const dual_quat& b)
+{
+	return dual_quat(a.real + b.real, a.dual + b.dual);
+}
+
+dual_quat operator*(const dual_quat& dq, float f)
+{
+	return dual_quat(dq.real * f, dq.dual * f);
+}
+
+dual_quat normalized(const dual_quat& dq)
+{
+	float length_sq = len_sq(dq.real);
+	if (length_sq < QUAT_EPSILON) {
+		return dual_quat();
+	}
+	return dq * (1.0f / sqrtf(length_sq));
+}
+
+dual_quat transform_to_dual_quat(const Transform& t)
+{
+	// dual = t * r / 2: (t w_r + t x v_r, -t . v_r) / 2
+	const quat& r = t.rotation;
+	vec3 d = (t.position * r.w + cross(t.position, r.vector)) * 0.5f;
+	return dual_quat(r, quat(d.x, d.y, d.z, -0.5f * dot(t.position, r.vector)));
+}
+
+vec3 get_translation(const dual_quat& dq)
+{
+	// t = 2 dual * conjugate(real)
+	const quat& r = dq.real;
+	const quat& d = dq.dual;
+	return (d.vector * r.w - r.vector * d.w + cross(r.vector, d.vector)) * 2.0f;
+}
+
+Transform dual_quat_to_transform(const dual_quat& dq)
+{
+	return Transform(get_translation(dq), dq.real, vec3(1, 1, 1));
+}
+
+vec3 transform_vector(const dual_quat& dq, const vec3& v)
+{
+	const quat& r = dq.real;
+	return v + cross(r.vector, cross(r.vector, v) + v * r.w) * 2.0f;
+}
+
+vec3 transform_point(const dual_quat& dq, const vec3& p)
+{
+	return transform_vector(dq, p) + get_translation(dq);
+}
\ No newline at end of file
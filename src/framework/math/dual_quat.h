@@ -0,0 +1,31 @@
+#pragma once
+
+#include "quat.h"
+#include "transform.h"
+
+// Rigid transform as a dual quaternion: real is the rotation and dual is half the translation times the rotation (t * r / 2,
+// with the Hamilton product, which is not the order of operator* of quat). 8 floats instead of the 16 of a matrix
+struct dual_quat {
+	quat real;
+	quat dual;
+
+	inline dual_quat() :
+		real(0, 0, 0, 1), dual(0, 0, 0, 0) { }
+	inline dual_quat(const quat& r, const quat& d) :
+		real(r), dual(d) { }
+};
+
+dual_quat operator+(const dual_quat& a, const dual_quat& b);
+dual_quat operator*(const dual_quat& dq, float f);
+
+// Divide by the length of the real part (a blend of unit dual quaternions is not unit)
+dual_quat normalized(const dual_quat& dq);
+
+// The scale of the transform is ignored
+dual_quat transform_to_dual_quat(const Transform& t);
+Transform dual_quat_to_transform(const dual_quat& dq);
+vec3 get_translation(const dual_quat& dq);
+
+// dq must be normalized
+vec3 transform_point(const dual_quat& dq, const vec3& p);
+vec3 transform_vector(const dual_quat& dq, const vec3& v);
\ No newline at end of file
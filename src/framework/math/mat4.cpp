@@ -1,6 +1,8 @@
 #include "mat4.h"
+#include <chrono>
 #include <iostream>
 #include <math.h>
+#include <vector>
 
 // It takes two numbers, the row of "a" and the column of "b", to dot together and the result is the dot product of the two.
 #define M4D(aRow, bCol) \
@@ -179,7 +181,23 @@ mat4 adjugate(const mat4& m)
 }
 
 // It returns a new matrix that is the inverse of the provided matrix
+// Rigid and affine matrices (most model, view and joint matrices) take a cheaper path than the general one
 mat4 inverse(const mat4& m)
+{
+	if (is_affine(m)) {
+		return is_rigid(m) ? inverse_rigid(m) : inverse_affine(m);
+	}
+	return inverse_general(m);
+}
+
+// Invert the matrix inline, modifying the argument
+void invert(mat4& m)
+{
+	m = inverse(m);
+}
+
+// Inverse of any 4x4 matrix: the adjugate divided by the determinant
+mat4 inverse_general(const mat4& m)
 {
 	float det = determinant(m);
 	if (det == 0.0f) {
@@ -190,16 +208,107 @@ mat4 inverse(const mat4& m)
 	return adj * (1.0f / det);
 }
 
-// Invert the matrix inline, modifying the argument
-void invert(mat4& m)
+// The last row is (0, 0, 0, 1): translation, rotation, scale and shear only
+bool is_affine(const mat4& m)
 {
-	float det = determinant(m);
+	return fabsf(m.xw) < MAT4_EPSILON && fabsf(m.yw) < MAT4_EPSILON && fabsf(m.zw) < MAT4_EPSILON && fabsf(m.tw - 1.0f) < MAT4_EPSILON;
+}
+
+// Affine and the 3x3 part is orthonormal: translation and rotation only
+bool is_rigid(const mat4& m)
+{
+	const float eps = 0.00001f;
+	float xx = m.xx * m.xx + m.xy * m.xy + m.xz * m.xz;
+	float yy = m.yx * m.yx + m.yy * m.yy + m.yz * m.yz;
+	float zz = m.zx * m.zx + m.zy * m.zy + m.zz * m.zz;
+	float xy = m.xx * m.yx + m.xy * m.yy + m.xz * m.yz;
+	float xz = m.xx * m.zx + m.xy * m.zy + m.xz * m.zz;
+	float yz = m.yx * m.zx + m.yy * m.zy + m.yz * m.zz;
+	return is_affine(m) &&
+		fabsf(xx - 1.0f) < eps && fabsf(yy - 1.0f) < eps && fabsf(zz - 1.0f) < eps &&
+		fabsf(xy) < eps && fabsf(xz) < eps && fabsf(yz) < eps;
+}
+
+// M = T * R -> inverse(M) = transpose(R) * -T
+// The rotation is orthonormal, so its inverse is its transpose, and the translation is rotated back and negated
+mat4 inverse_rigid(const mat4& m)
+{
+	return mat4(
+		m.xx, m.yx, m.zx, 0.0f,
+		m.xy, m.yy, m.zy, 0.0f,
+		m.xz, m.yz, m.zz, 0.0f,
+		-(m.xx * m.tx + m.xy * m.ty + m.xz * m.tz),
+		-(m.yx * m.tx + m.yy * m.ty + m.yz * m.tz),
+		-(m.zx * m.tx + m.zy * m.ty + m.zz * m.tz),
+		1.0f
+	);
+}
+
+// M = T * A -> inverse(M) = inverse(A) * -T, where A is the 3x3 part (rotation, scale and shear)
+// The rows of inverse(A) are the cross products of the columns of A divided by its determinant
+mat4 inverse_affine(const mat4& m)
+{
+	// rows of the adjugate of A
+	float r0x = m.yy * m.zz - m.yz * m.zy, r0y = m.yz * m.zx - m.yx * m.zz, r0z = m.yx * m.zy - m.yy * m.zx; // cross(up, forward)
+	float r1x = m.zy * m.xz - m.zz * m.xy, r1y = m.zz * m.xx - m.zx * m.xz, r1z = m.zx * m.xy - m.zy * m.xx; // cross(forward, right)
+	float r2x = m.xy * m.yz - m.xz * m.yy, r2y = m.xz * m.yx - m.xx * m.yz, r2z = m.xx * m.yy - m.xy * m.yx; // cross(right, up)
+
+	float det = m.xx * r0x + m.xy * r0y + m.xz * r0z;
 	if (det == 0.0f) {
 		std::cout << " Warning: Matrix determinant is 0\n";
-		m = mat4();
-		return;
+		return mat4();
+	}
+	float inv_det = 1.0f / det;
+	r0x *= inv_det; r0y *= inv_det; r0z *= inv_det;
+	r1x *= inv_det; r1y *= inv_det; r1z *= inv_det;
+	r2x *= inv_det; r2y *= inv_det; r2z *= inv_det;
+
+	return mat4(
+		r0x, r1x, r2x, 0.0f,
+		r0y, r1y, r2y, 0.0f,
+		r0z, r1z, r2z, 0.0f,
+		-(r0x * m.tx + r0y * m.ty + r0z * m.tz),
+		-(r1x * m.tx + r1y * m.ty + r1z * m.tz),
+		-(r2x * m.tx + r2y * m.ty + r2z * m.tz),
+		1.0f
+	);
+}
+
+// Random-looking rigid matrices (views from points around the origin), scaled non-uniformly unless only rigid ones are wanted
+float benchmark_inverse(InversePath path, unsigned int num_matrices, unsigned int iterations)
+{
+	std::vector<mat4> matrices(num_matrices);
+	for (unsigned int i = 0; i < num_matrices; i++) {
+		float angle = i * 0.37f;
+		vec3 position(cosf(angle) * 10.0f, sinf(angle * 1.3f) * 10.0f, sinf(angle) * 10.0f);
+		matrices[i] = look_at(position, vec3(sinf(angle * 2.1f), 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+		if (path != INVERSE_RIGID) {
+			matrices[i] = matrices[i] * mat4(
+				1.5f + sinf(angle), 0, 0, 0,
+				0, 1.0f + 0.5f * cosf(angle), 0, 0,
+				0, 0, 0.25f, 0,
+				0, 0, 0, 1);
+		}
+	}
+
+	float sum = 0.0f; // read after the loop, so the inverses are not optimized away
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int it = 0; it < iterations; it++) {
+		for (unsigned int i = 0; i < num_matrices; i++) {
+			mat4 result;
+			switch (path) {
+			case INVERSE_GENERAL: result = inverse_general(matrices[i]); break;
+			case INVERSE_AFFINE: result = inverse_affine(matrices[i]); break;
+			case INVERSE_RIGID: result = inverse_rigid(matrices[i]); break;
+			case INVERSE_AUTOMATIC: result = inverse(matrices[i]); break;
+			}
+			sum += result.tx;
+		}
 	}
-	m = adjugate(m) * (1.0f / det);
+	float nanoseconds = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+	volatile float sink = sum;
+	(void)sink;
+	return num_matrices * iterations > 0 ? nanoseconds / (num_matrices * iterations) : 0.0f;
 }
 
 // It constructs a view frustum
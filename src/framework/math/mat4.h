@@ -72,6 +72,16 @@ float determinant(const mat4& m);
 mat4 adjugate(const mat4& m);
 mat4 inverse(const mat4& m);
 void invert(mat4& m);
+// Specialized inverses, inverse(m) picks one of them automatically
+mat4 inverse_general(const mat4& m);
+mat4 inverse_affine(const mat4& m);
+mat4 inverse_rigid(const mat4& m);
+bool is_affine(const mat4& m);
+bool is_rigid(const mat4& m);
+
+enum InversePath { INVERSE_GENERAL, INVERSE_AFFINE, INVERSE_RIGID, INVERSE_AUTOMATIC };
+// Nanoseconds per inverse with a path, of rigid matrices for INVERSE_RIGID and of affine ones with non-uniform scale for the rest
+float benchmark_inverse(InversePath path, unsigned int num_matrices = 1000, unsigned int iterations = 100);
 
 mat4 frustum(float l, float r, float b, float t, float n, float f);
 mat4 perspective(float fov, float aspect, float n, float f);
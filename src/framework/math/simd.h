@@ -0,0 +1,246 @@
+#pragma once
+
+// Thin wrapper over the SIMD instructions available at compile time, so the same kernel can be written once
+// and process SIMD_WIDTH floats at a time: AVX (8), SSE (4) or a scalar fallback (1)
+// Everything lives in a namespace named after the instruction set, so the same code can be compiled with different
+// instruction sets in different files without mixing their definitions (see batch_kernels_avx2.cpp)
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__AVX__)
+	#define SIMD_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SIMD_SSE
+	#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <malloc.h>
+	#define SIMD_INLINE __forceinline
+#else
+	#define SIMD_INLINE inline __attribute__((always_inline))
+#endif
+
+#define SIMD_ALIGNMENT 32
+
+#if defined(SIMD_AVX)
+	#define SIMD_NAMESPACE simd_avx
+#elif defined(SIMD_SSE)
+	#define SIMD_NAMESPACE simd_sse
+#else
+	#define SIMD_NAMESPACE simd_scalar
+#endif
+
+#define SIMD_NAMESPACE_BEGIN inline namespace SIMD_NAMESPACE {
+#define SIMD_NAMESPACE_END }
+
+SIMD_NAMESPACE_BEGIN
+
+#if defined(SIMD_AVX)
+
+#define SIMD_WIDTH 8
+typedef __m256 simd_float;
+
+SIMD_INLINE simd_float simd_load(const float* p) { return _mm256_load_ps(p); }
+SIMD_INLINE simd_float simd_loadu(const float* p) { return _mm256_loadu_ps(p); }
+SIMD_INLINE void simd_store(float* p, simd_float a) { _mm256_store_ps(p, a); }
+SIMD_INLINE void simd_storeu(float* p, simd_float a) { _mm256_storeu_ps(p, a); }
+SIMD_INLINE simd_float simd_set1(float f) { return _mm256_set1_ps(f); }
+SIMD_INLINE simd_float simd_add(simd_float a, simd_float b) { return _mm256_add_ps(a, b); }
+SIMD_INLINE simd_float simd_sub(simd_float a, simd_float b) { return _mm256_sub_ps(a, b); }
+SIMD_INLINE simd_float simd_mul(simd_float a, simd_float b) { return _mm256_mul_ps(a, b); }
+SIMD_INLINE simd_float simd_div(simd_float a, simd_float b) { return _mm256_div_ps(a, b); }
+SIMD_INLINE simd_float simd_sqrt(simd_float a) { return _mm256_sqrt_ps(a); }
+SIMD_INLINE simd_float simd_max(simd_float a, simd_float b) { return _mm256_max_ps(a, b); }
+SIMD_INLINE simd_float simd_xor(simd_float a, simd_float b) { return _mm256_xor_ps(a, b); }
+// keeps only the sign bit of every lane, so simd_xor(b, simd_sign_mask(a)) flips b where a is negative
+SIMD_INLINE simd_float simd_sign_mask(simd_float a) { return _mm256_and_ps(a, _mm256_set1_ps(-0.0f)); }
+SIMD_INLINE simd_float simd_and(simd_float a, simd_float b) { return _mm256_and_ps(a, b); }
+// all bits set in the lanes where a >= b (a mask for simd_and and simd_select)
+SIMD_INLINE simd_float simd_greater_equal(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+// lanes of a where the mask is set, lanes of b elsewhere
+SIMD_INLINE simd_float simd_select(simd_float mask, simd_float a, simd_float b) { return _mm256_blendv_ps(b, a, mask); }
+// loads SIMD_WIDTH unsigned 16 bit integers as floats
+SIMD_INLINE simd_float simd_load_u16(const uint16_t* p)
+{
+	__m128i v = _mm_loadu_si128((const __m128i*)p);
+	__m128i zero = _mm_setzero_si128();
+	return _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(v, zero)), _mm_unpackhi_epi16(v, zero), 1));
+}
+// loads base[ids[0]], ..., base[ids[SIMD_WIDTH - 1]]
+#if defined(__AVX2__)
+SIMD_INLINE simd_float simd_gather(const float* base, const int* ids)
+{
+	return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)ids), 4);
+}
+// loads base[0], base[stride], ..., base[(SIMD_WIDTH - 1) * stride]
+SIMD_INLINE simd_float simd_gather_stride(const float* base, int stride)
+{
+	return _mm256_i32gather_ps(base, _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride)), 4);
+}
+#else
+SIMD_INLINE simd_float simd_gather(const float* base, const int* ids)
+{
+	return _mm256_setr_ps(base[ids[0]], base[ids[1]], base[ids[2]], base[ids[3]], base[ids[4]], base[ids[5]], base[ids[6]], base[ids[7]]);
+}
+SIMD_INLINE simd_float simd_gather_stride(const float* base, int stride)
+{
+	return _mm256_setr_ps(base[0], base[stride], base[2 * stride], base[3 * stride], base[4 * stride], base[5 * stride], base[6 * stride], base[7 * stride]);
+}
+#endif
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+SIMD_INLINE simd_float simd_madd(simd_float a, simd_float b, simd_float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+SIMD_INLINE simd_float simd_madd(simd_float a, simd_float b, simd_float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+
+#elif defined(SIMD_SSE)
+
+#define SIMD_WIDTH 4
+typedef __m128 simd_float;
+
+SIMD_INLINE simd_float simd_load(const float* p) { return _mm_load_ps(p); }
+SIMD_INLINE simd_float simd_loadu(const float* p) { return _mm_loadu_ps(p); }
+SIMD_INLINE void simd_store(float* p, simd_float a) { _mm_store_ps(p, a); }
+SIMD_INLINE void simd_storeu(float* p, simd_float a) { _mm_storeu_ps(p, a); }
+SIMD_INLINE simd_float simd_set1(float f) { return _mm_set1_ps(f); }
+SIMD_INLINE simd_float simd_add(simd_float a, simd_float b) { return _mm_add_ps(a, b); }
+SIMD_INLINE simd_float simd_sub(simd_float a, simd_float b) { return _mm_sub_ps(a, b); }
+SIMD_INLINE simd_float simd_mul(simd_float a, simd_float b) { return _mm_mul_ps(a, b); }
+SIMD_INLINE simd_float simd_div(simd_float a, simd_float b) { return _mm_div_ps(a, b); }
+SIMD_INLINE simd_float simd_sqrt(simd_float a) { return _mm_sqrt_ps(a); }
+SIMD_INLINE simd_float simd_max(simd_float a, simd_float b) { return _mm_max_ps(a, b); }
+SIMD_INLINE simd_float simd_xor(simd_float a, simd_float b) { return _mm_xor_ps(a, b); }
+SIMD_INLINE simd_float simd_sign_mask(simd_float a) { return _mm_and_ps(a, _mm_set1_ps(-0.0f)); }
+SIMD_INLINE simd_float simd_and(simd_float a, simd_float b) { return _mm_and_ps(a, b); }
+SIMD_INLINE simd_float simd_greater_equal(simd_float a, simd_float b) { return _mm_cmpge_ps(a, b); }
+SIMD_INLINE simd_float simd_select(simd_float mask, simd_float a, simd_float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+SIMD_INLINE simd_float simd_load_u16(const uint16_t* p)
+{
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128()));
+}
+SIMD_INLINE simd_float simd_gather(const float* base, const int* ids)
+{
+	return _mm_setr_ps(base[ids[0]], base[ids[1]], base[ids[2]], base[ids[3]]);
+}
+SIMD_INLINE simd_float simd_gather_stride(const float* base, int stride)
+{
+	return _mm_setr_ps(base[0], base[stride], base[2 * stride], base[3 * stride]);
+}
+SIMD_INLINE simd_float simd_madd(simd_float a, simd_float b, simd_float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+#else
+
+#define SIMD_WIDTH 1
+typedef float simd_float;
+
+SIMD_INLINE simd_float simd_load(const float* p) { return *p; }
+SIMD_INLINE simd_float simd_loadu(const float* p) { return *p; }
+SIMD_INLINE void simd_store(float* p, simd_float a) { *p = a; }
+SIMD_INLINE void simd_storeu(float* p, simd_float a) { *p = a; }
+SIMD_INLINE simd_float simd_set1(float f) { return f; }
+SIMD_INLINE simd_float simd_add(simd_float a, simd_float b) { return a + b; }
+SIMD_INLINE simd_float simd_sub(simd_float a, simd_float b) { return a - b; }
+SIMD_INLINE simd_float simd_mul(simd_float a, simd_float b) { return a * b; }
+SIMD_INLINE simd_float simd_div(simd_float a, simd_float b) { return a / b; }
+SIMD_INLINE simd_float simd_sqrt(simd_float a) { return sqrtf(a); }
+SIMD_INLINE simd_float simd_max(simd_float a, simd_float b) { return a > b ? a : b; }
+SIMD_INLINE simd_float simd_xor(simd_float a, simd_float b)
+{
+	unsigned int ia, ib;
+	memcpy(&ia, &a, 4); memcpy(&ib, &b, 4);
+	ia ^= ib;
+	memcpy(&a, &ia, 4);
+	return a;
+}
+SIMD_INLINE simd_float simd_sign_mask(simd_float a) { return std::signbit(a) ? -0.0f : 0.0f; }
+SIMD_INLINE simd_float simd_and(simd_float a, simd_float b)
+{
+	unsigned int ia, ib;
+	memcpy(&ia, &a, 4); memcpy(&ib, &b, 4);
+	ia &= ib;
+	memcpy(&a, &ia, 4);
+	return a;
+}
+SIMD_INLINE simd_float simd_greater_equal(simd_float a, simd_float b)
+{
+	unsigned int bits = a >= b ? 0xffffffffu : 0u;
+	memcpy(&a, &bits, 4);
+	return a;
+}
+SIMD_INLINE simd_float simd_select(simd_float mask, simd_float a, simd_float b)
+{
+	unsigned int bits;
+	memcpy(&bits, &mask, 4);
+	return bits ? a : b;
+}
+SIMD_INLINE simd_float simd_load_u16(const uint16_t* p) { return (float)*p; }
+SIMD_INLINE simd_float simd_gather(const float* base, const int* ids) { return base[ids[0]]; }
+SIMD_INLINE simd_float simd_gather_stride(const float* base, int stride) { return base[0]; }
+SIMD_INLINE simd_float simd_madd(simd_float a, simd_float b, simd_float c) { return a * b + c; }
+
+#endif
+
+// stores every lane at base[0], base[stride], ..., base[(SIMD_WIDTH - 1) * stride]
+SIMD_INLINE void simd_scatter_stride(float* base, int stride, simd_float a)
+{
+	alignas(SIMD_ALIGNMENT) float lanes[SIMD_WIDTH];
+	simd_store(lanes, a);
+	for (int lane = 0; lane < SIMD_WIDTH; lane++) {
+		base[lane * stride] = lanes[lane];
+	}
+}
+
+// Round up a number of elements so the streams can always be processed in full SIMD blocks
+inline unsigned int simd_padded_size(unsigned int size)
+{
+	return (size + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+}
+
+SIMD_NAMESPACE_END
+
+// Allocator that aligns the memory to SIMD_ALIGNMENT bytes, so streams of floats can be read with aligned loads
+template <typename T>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	AlignedAllocator() = default;
+	template <typename U> AlignedAllocator(const AlignedAllocator<U>&) { }
+
+	T* allocate(size_t n)
+	{
+		size_t bytes = (n * sizeof(T) + SIMD_ALIGNMENT - 1) / SIMD_ALIGNMENT * SIMD_ALIGNMENT;
+#if defined(_MSC_VER)
+		void* p = _aligned_malloc(bytes, SIMD_ALIGNMENT);
+#else
+		void* p = aligned_alloc(SIMD_ALIGNMENT, bytes);
+#endif
+		if (!p) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+
+	template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+	template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using aligned_vector = std::vector<T, AlignedAllocator<T>>;
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "simd.h"
+
+// Transform math for SIMD_WIDTH transforms at once, one register per component.
+// Same conventions as transform.cpp and quat.cpp, so the results match combine, mix, nlerp and transform_to_mat4
+
+SIMD_NAMESPACE_BEGIN
+
+struct simd_transform
+{
+	simd_float px, py, pz;			// position
+	simd_float rx, ry, rz, rw;		// rotation
+	simd_float sx, sy, sz;			// scale
+};
+
+// q = a * b (right-to-left, see operator*(quat, quat))
+SIMD_INLINE void simd_quat_mul(simd_float ax, simd_float ay, simd_float az, simd_float aw,
+	simd_float bx, simd_float by, simd_float bz, simd_float bw,
+	simd_float& x, simd_float& y, simd_float& z, simd_float& w)
+{
+	x = simd_add(simd_sub(simd_add(simd_mul(bx, aw), simd_mul(by, az)), simd_mul(bz, ay)), simd_mul(bw, ax));
+	y = simd_add(simd_add(simd_sub(simd_mul(by, aw), simd_mul(bx, az)), simd_mul(bz, ax)), simd_mul(bw, ay));
+	z = simd_add(simd_add(simd_sub(simd_mul(bx, ay), simd_mul(by, ax)), simd_mul(bz, aw)), simd_mul(bw, az));
+	w = simd_sub(simd_sub(simd_sub(simd_mul(bw, aw), simd_mul(bx, ax)), simd_mul(by, ay)), simd_mul(bz, az));
+}
+
+// Same as combine(parent, local)
+SIMD_INLINE simd_transform simd_combine(const simd_transform& parent, const simd_transform& local)
+{
+	simd_transform out;
+
+	// scale = parent.scale * local.scale
+	out.sx = simd_mul(parent.sx, local.sx);
+	out.sy = simd_mul(parent.sy, local.sy);
+	out.sz = simd_mul(parent.sz, local.sz);
+
+	// rotation = local.rotation * parent.rotation
+	simd_quat_mul(local.rx, local.ry, local.rz, local.rw, parent.rx, parent.ry, parent.rz, parent.rw, out.rx, out.ry, out.rz, out.rw);
+
+	// position = parent.position + parent.rotation * (parent.scale * local.position)
+	// v' = v + w * t + cross(q, t), with t = 2 * cross(q, v)
+	simd_float vx = simd_mul(parent.sx, local.px), vy = simd_mul(parent.sy, local.py), vz = simd_mul(parent.sz, local.pz);
+	simd_float two = simd_set1(2.f);
+	simd_float tx = simd_mul(two, simd_sub(simd_mul(parent.ry, vz), simd_mul(parent.rz, vy)));
+	simd_float ty = simd_mul(two, simd_sub(simd_mul(parent.rz, vx), simd_mul(parent.rx, vz)));
+	simd_float tz = simd_mul(two, simd_sub(simd_mul(parent.rx, vy), simd_mul(parent.ry, vx)));
+	out.px = simd_add(parent.px, simd_add(simd_madd(parent.rw, tx, vx), simd_sub(simd_mul(parent.ry, tz), simd_mul(parent.rz, ty))));
+	out.py = simd_add(parent.py, simd_add(simd_madd(parent.rw, ty, vy), simd_sub(simd_mul(parent.rz, tx), simd_mul(parent.rx, tz))));
+	out.pz = simd_add(parent.pz, simd_add(simd_madd(parent.rw, tz, vz), simd_sub(simd_mul(parent.rx, ty), simd_mul(parent.ry, tx))));
+
+	return out;
+}
+
+// a + (b - a) * t
+SIMD_INLINE simd_float simd_lerp(simd_float a, simd_float b, simd_float t)
+{
+	return simd_madd(simd_sub(b, a), t, a);
+}
+
+// Same as nlerp(from, to, t). Quaternions of length zero stay zero instead of becoming the identity
+SIMD_INLINE void simd_nlerp(simd_float ax, simd_float ay, simd_float az, simd_float aw,
+	simd_float bx, simd_float by, simd_float bz, simd_float bw, simd_float t,
+	simd_float& x, simd_float& y, simd_float& z, simd_float& w)
+{
+	x = simd_lerp(ax, bx, t);
+	y = simd_lerp(ay, by, t);
+	z = simd_lerp(az, bz, t);
+	w = simd_lerp(aw, bw, t);
+	simd_float len_sq = simd_madd(x, x, simd_madd(y, y, simd_madd(z, z, simd_mul(w, w))));
+	simd_float inv_len = simd_div(simd_set1(1.f), simd_sqrt(simd_max(len_sq, simd_set1(1e-12f))));
+	x = simd_mul(x, inv_len);
+	y = simd_mul(y, inv_len);
+	z = simd_mul(z, inv_len);
+	w = simd_mul(w, inv_len);
+}
+
+// Same as mix(a, b, t): the rotation takes the shortest path (b is negated where dot(a, b) < 0)
+SIMD_INLINE simd_transform simd_mix(const simd_transform& a, const simd_transform& b, simd_float t)
+{
+	simd_transform out;
+	out.px = simd_lerp(a.px, b.px, t);
+	out.py = simd_lerp(a.py, b.py, t);
+	out.pz = simd_lerp(a.pz, b.pz, t);
+	out.sx = simd_lerp(a.sx, b.sx, t);
+	out.sy = simd_lerp(a.sy, b.sy, t);
+	out.sz = simd_lerp(a.sz, b.sz, t);
+
+	simd_float d = simd_madd(a.rx, b.rx, simd_madd(a.ry, b.ry, simd_madd(a.rz, b.rz, simd_mul(a.rw, b.rw))));
+	simd_float flip = simd_sign_mask(d);
+	simd_nlerp(a.rx, a.ry, a.rz, a.rw, simd_xor(b.rx, flip), simd_xor(b.ry, flip), simd_xor(b.rz, flip), simd_xor(b.rw, flip), t,
+		out.rx, out.ry, out.rz, out.rw);
+	return out;
+}
+
+// Same as transform_to_mat4: writes the 16 components (column-major) of every matrix into m[16]
+SIMD_INLINE void simd_transform_to_mat4(const simd_transform& t, simd_float* m)
+{
+	simd_float one = simd_set1(1.f), two = simd_set1(2.f), zero = simd_set1(0.f);
+	simd_float xx = simd_mul(t.rx, t.rx), yy = simd_mul(t.ry, t.ry), zz = simd_mul(t.rz, t.rz);
+	simd_float xy = simd_mul(t.rx, t.ry), xz = simd_mul(t.rx, t.rz), yz = simd_mul(t.ry, t.rz);
+	simd_float wx = simd_mul(t.rw, t.rx), wy = simd_mul(t.rw, t.ry), wz = simd_mul(t.rw, t.rz);
+
+	// rotation matrix columns scaled by the scale of each axis
+	m[0] = simd_mul(t.sx, simd_sub(one, simd_mul(two, simd_add(yy, zz))));
+	m[1] = simd_mul(t.sx, simd_mul(two, simd_add(xy, wz)));
+	m[2] = simd_mul(t.sx, simd_mul(two, simd_sub(xz, wy)));
+	m[3] = zero;
+	m[4] = simd_mul(t.sy, simd_mul(two, simd_sub(xy, wz)));
+	m[5] = simd_mul(t.sy, simd_sub(one, simd_mul(two, simd_add(xx, zz))));
+	m[6] = simd_mul(t.sy, simd_mul(two, simd_add(yz, wx)));
+	m[7] = zero;
+	m[8] = simd_mul(t.sz, simd_mul(two, simd_add(xz, wy)));
+	m[9] = simd_mul(t.sz, simd_mul(two, simd_sub(yz, wx)));
+	m[10] = simd_mul(t.sz, simd_sub(one, simd_mul(two, simd_add(xx, yy))));
+	m[11] = zero;
+	m[12] = t.px;
+	m[13] = t.py;
+	m[14] = t.pz;
+	m[15] = one;
+}
+
+SIMD_NAMESPACE_END
\ No newline at end of file
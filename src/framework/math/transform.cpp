@@ -57,6 +57,32 @@ mat4 transform_to_mat4(const Transform& t)
 	return mat4();
 }
 
+// Matrix of the inverse of a transform, without building the matrix of the transform and inverting it
+// M = T * R * S -> inverse(M) = inverse(S) * transpose(R) * -T, so the rows of the 3x3 part are the rotation axes divided by the scale
+mat4 transform_to_inverse_mat4(const Transform& t)
+{
+	const quat& q = t.rotation;
+	// rotation axes (columns of the rotation matrix)
+	vec3 x = vec3(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y));
+	vec3 y = vec3(2.0f * (q.x * q.y - q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x));
+	vec3 z = vec3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+
+	x = x * (fabs(t.scale.x) < VEC3_EPSILON ? 0.0f : 1.0f / t.scale.x);
+	y = y * (fabs(t.scale.y) < VEC3_EPSILON ? 0.0f : 1.0f / t.scale.y);
+	z = z * (fabs(t.scale.z) < VEC3_EPSILON ? 0.0f : 1.0f / t.scale.z);
+
+	const vec3& p = t.position;
+	return mat4(
+		x.x, y.x, z.x, 0.0f,
+		x.y, y.y, z.y, 0.0f,
+		x.z, y.z, z.z, 0.0f,
+		-(x.x * p.x + x.y * p.y + x.z * p.z),
+		-(y.x * p.x + y.y * p.y + y.z * p.z),
+		-(z.x * p.x + z.y * p.y + z.z * p.z),
+		1.0f
+	);
+}
+
 vec3 transform_point(const Transform& a, const vec3& b)
 {
 	vec3 out;
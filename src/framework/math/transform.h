@@ -25,5 +25,6 @@ Transform inverse(const Transform& t);
 Transform mix(const Transform& a, const Transform& b, float t);
 Transform mat4_to_transform(const mat4& m);
 mat4 transform_to_mat4(const Transform& t);
+mat4 transform_to_inverse_mat4(const Transform& t);
 vec3 transform_point(const Transform& a, const vec3& b);
 vec3 transform_vector(const Transform& a, const vec3& b);
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Pool of reusable objects (e.g. temporary poses or matrix palettes) so the code that needs one every frame does not allocate.
+// Objects are given back as they were left: the buffers they own keep their capacity, so resizing them again is free
+template <typename T>
+class ObjectPool
+{
+protected:
+	std::mutex mutex;
+	std::vector<std::unique_ptr<T>> free_objects;
+	size_t num_created = 0;
+
+public:
+	// Returns the object to its pool when it goes out of scope
+	struct Releaser
+	{
+		ObjectPool* pool = nullptr;
+		void operator()(T* object) const { pool->release(object); }
+	};
+	typedef std::unique_ptr<T, Releaser> Handle;
+
+	// Pool shared by the whole application for this type
+	static ObjectPool& get()
+	{
+		static ObjectPool pool;
+		return pool;
+	}
+
+	// Get an object of the pool (a new one if all of them are in use)
+	Handle acquire()
+	{
+		std::unique_ptr<T> object;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!free_objects.empty()) {
+				object = std::move(free_objects.back());
+				free_objects.pop_back();
+			}
+			else {
+				num_created++;
+			}
+		}
+		if (!object) {
+			object = std::make_unique<T>();
+		}
+		return Handle(object.release(), Releaser{ this });
+	}
+
+	void release(T* object)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		free_objects.emplace_back(object);
+	}
+
+	size_t get_num_created() { std::lock_guard<std::mutex> lock(mutex); return num_created; }
+	size_t get_num_free() { std::lock_guard<std::mutex> lock(mutex); return free_objects.size(); }
+};
+
+// Handle to an object of a pool: auto pose = acquire_pooled<Pose>();
+template <typename T>
+using Pooled = typename ObjectPool<T>::Handle;
+
+template <typename T>
+Pooled<T> acquire_pooled()
+{
+	return ObjectPool<T>::get().acquire();
+}
\ No newline at end of file
@@ -10,6 +10,14 @@
 #include "ImGuizmo.h"
 
 #include "framework/application.h"
+#include "framework/frame_arena.h"
+#include "framework/job_system.h"
+#include "framework/animations/animation_lod.h"
+#include "framework/animations/baked_palettes.h"
+#include "framework/animations/clip_cache.h"
+#include "framework/animations/ik.h"
+#include "framework/animations/skeleton.h"
+#include "framework/graphics/skin_palettes.h"
 
 // Globals
 Application* app;
@@ -29,6 +37,54 @@ void render_gui(GLFWwindow* window, Application* app)
 		if (ImGui::TreeNode("Debugger")) {
 			ImGui::Checkbox("View wireframe", &app->flag_wireframe);
 			ImGui::Checkbox("View grid", &app->flag_grid);
+			ImGui::Text("Joints evaluated: %u", Pose::num_evaluated_joints.load());
+			ImGui::Text("Job system: %u threads", JobSystem::get().get_num_threads());
+			FrameArena& arena = FrameArena::get();
+			ImGui::Text("Frame arena: %.1f KB (peak %.1f KB / %.1f KB)", arena.get_last_frame_bytes() / 1024.f, arena.get_peak_bytes() / 1024.f, arena.get_capacity() / 1024.f);
+			ClipCache& clip_cache = ClipCache::get();
+			ImGui::Text("Clip cache: %.0f%% hits (%u hits, %u samples, %u / %u poses)", clip_cache.get_hit_rate() * 100.f, clip_cache.get_hits(), clip_cache.get_misses(), clip_cache.size(), clip_cache.get_capacity());
+			float time_step = clip_cache.get_time_step() * 1000.f;
+			if (ImGui::DragFloat("Clip cache step (ms)", &time_step, 0.1f, 0.f, 100.f)) {
+				clip_cache.set_time_step(time_step / 1000.f);
+			}
+			SkinPalettes& skin_palettes = SkinPalettes::get();
+			ImGui::Text("Skin palettes: %u uploads (%.1f KB) of %u buffers", skin_palettes.get_uploads(), skin_palettes.get_bytes() / 1024.f, skin_palettes.size());
+			ImGui::Text("Animation LODs: %u / %u / %u / %u (frozen)", AnimationLOD::get_num_entities(0), AnimationLOD::get_num_entities(1), AnimationLOD::get_num_entities(2), AnimationLOD::get_num_entities(3));
+			ImGui::DragFloat3("LOD min screen sizes", AnimationLOD::settings.min_screen_size, 0.001f, 0.f, 1.f);
+			// nanoseconds per matrix inverse with every path
+			static float inverse_times[4] = { };
+			if (ImGui::Button("Benchmark inverse")) {
+				inverse_times[0] = benchmark_inverse(INVERSE_GENERAL);
+				inverse_times[1] = benchmark_inverse(INVERSE_AFFINE);
+				inverse_times[2] = benchmark_inverse(INVERSE_RIGID);
+				inverse_times[3] = benchmark_inverse(INVERSE_AUTOMATIC);
+			}
+			ImGui::Text("Matrix inverse (ns): general %.1f, affine %.1f, rigid %.1f, automatic %.1f", inverse_times[0], inverse_times[1], inverse_times[2], inverse_times[3]);
+			// solves per millisecond of chains of 3, 10 and 30 joints
+			static float ik_solves[2][3] = { };
+			static float ik_two_bone_solves = 0.f;
+			if (ImGui::Button("Benchmark IK")) {
+				unsigned int chain_sizes[3] = { 3, 10, 30 };
+				for (unsigned int i = 0; i < 3; i++) {
+					ik_solves[0][i] = IKChain::benchmark(IK_CCD, chain_sizes[i]);
+					ik_solves[1][i] = IKChain::benchmark(IK_FABRIK, chain_sizes[i]);
+				}
+				ik_two_bone_solves = IKChain::benchmark(IK_TWO_BONE, 3);
+			}
+			ImGui::Text("IK solves/ms (3 / 10 / 30 joints): CCD %.0f / %.0f / %.0f, FABRIK %.0f / %.0f / %.0f, two bone %.0f", ik_solves[0][0], ik_solves[0][1], ik_solves[0][2], ik_solves[1][0], ik_solves[1][1], ik_solves[1][2], ik_two_bone_solves);
+			// microseconds to build the palette of 64 joints and skin 10000 vertices, and the palette bytes uploaded per frame
+			static float skinning_times[2] = { };
+			if (ImGui::Button("Benchmark skinning")) {
+				skinning_times[0] = Skeleton::benchmark_skinning(SKINNING_LINEAR, 64, 10000);
+				skinning_times[1] = Skeleton::benchmark_skinning(SKINNING_DUAL_QUAT, 64, 10000);
+			}
+			ImGui::Text("Skinning (64 joints, 10000 vertices): linear blend %.0f us (%u B), dual quaternion %.0f us (%u B)", skinning_times[0], (unsigned int)(64 * sizeof(mat4)), skinning_times[1], (unsigned int)(64 * sizeof(dual_quat)));
+			// largest difference of a skin matrix element between the baked palettes of 64 joints at 30 fps and the poses
+			static float palette_errors[2] = { };
+			if (ImGui::Button("Check baked palettes")) {
+				BakedPalettes::check(64, 30.0f, palette_errors[0], palette_errors[1]);
+			}
+			ImGui::Text("Baked palettes (64 joints, 30 fps): error %.6f at the frames, %.4f at any time", palette_errors[0], palette_errors[1]);
 			if (ImGui::IsMousePosValid())
 				ImGui::Text("Mouse pos: (%g, %g)", xpos, ypos);
 			else
@@ -144,6 +200,9 @@ void main_loop(GLFWwindow* window)
 		app->mouse_position.x = static_cast<float>(xpos);
 		app->mouse_position.y = static_cast<float>(ypos);
 
+		// GL work queued by the jobs (e.g. uploading the assets they decoded)
+		JobSystem::get().process_main_thread_jobs();
+
 		double curr_time = glfwGetTime();
 		double delta_time = curr_time - prev_frame_time;
 		prev_frame_time = curr_time;
@@ -169,6 +228,9 @@ void main_loop(GLFWwindow* window)
 		glfwSwapBuffers(window);
 
 		ImGui::EndFrame();
+
+		// free the temporaries of the frame
+		FrameArena::get().reset();
 	}
 }
 